@@ -0,0 +1,127 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-11.
+
+#include "include.h"
+
+// smallest size class; blocks of class N are ARENA_BLOCK_MIN << N bytes
+#define ARENA_BLOCK_MIN 64
+// chunk header size, keeping the blocks aligned
+#define ARENA_HEADER_SIZE ((sizeof(arena_chunk_t) + ARENA_BLOCK_MIN - 1) / ARENA_BLOCK_MIN * ARENA_BLOCK_MIN)
+
+static int arena_get_class(size_t size) {
+	for (int i = 0; i < ARENA_CLASSES; i++) {
+		if (size <= (size_t)ARENA_BLOCK_MIN << i)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Create an arena (slab allocator) for objects sharing a lifetime, e.g. everything belonging to a game.
+ *
+ * Blocks are carved out of ARENA_CHUNK_SIZE chunks, rounded up to a power-of-two size class; freed blocks
+ * go to the class's free list and are reused by the next allocation of that class. Nothing is returned
+ * to the system until arena_destroy(), which releases all chunks at once. Every arena has its own mutex,
+ * so threads of different games never contend for the allocator.
+ *
+ * @return the arena, NULL on error
+ */
+arena_t *arena_init() {
+	arena_t *arena;
+	MALLOC(arena, sizeof(*arena), return NULL);
+	arena->mutex = SDL_CreateMutex();
+	if (arena->mutex == NULL) {
+		free(arena);
+		SDL_ERROR("SDL_CreateMutex()", return NULL);
+	}
+	return arena;
+}
+
+/**
+ * Allocate a zero-initialized block from the arena.
+ *
+ * @param arena arena to allocate from, NULL to use malloc()
+ * @param size block size (bytes)
+ * @return the block, NULL on error
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+	if (arena == NULL)
+		return calloc(1, size);
+	int class = arena_get_class(size);
+	if (class < 0)
+		return NULL;
+	size_t block_size = (size_t)ARENA_BLOCK_MIN << class;
+	void *block		  = NULL;
+
+	SDL_LOCK_MUTEX(arena->mutex);
+	if (arena->free_list[class] != NULL) {
+		// reuse a freed block
+		block					= arena->free_list[class];
+		arena->free_list[class] = *(void **)block;
+	} else {
+		arena_chunk_t *chunk = arena->chunks;
+		if (chunk == NULL || chunk->size - chunk->used < block_size) {
+			// start a new chunk (large blocks get a chunk of their own)
+			size_t chunk_size = max(block_size, ARENA_CHUNK_SIZE);
+			chunk			  = malloc(ARENA_HEADER_SIZE + chunk_size);
+			if (chunk == NULL)
+				goto unlock;
+			chunk->size = chunk_size;
+			chunk->used = 0;
+			if (block_size >= ARENA_CHUNK_SIZE && arena->chunks != NULL) {
+				// keep carving the current chunk
+				chunk->next			= arena->chunks->next;
+				arena->chunks->next = chunk;
+			} else {
+				chunk->next	  = arena->chunks;
+				arena->chunks = chunk;
+			}
+			arena->size += ARENA_HEADER_SIZE + chunk_size;
+		}
+		block = (char *)chunk + ARENA_HEADER_SIZE + chunk->used;
+		chunk->used += block_size;
+	}
+	arena->used += block_size;
+	arena->used_max = max(arena->used_max, arena->used);
+	memset(block, 0, size);
+
+unlock:
+	SDL_UNLOCK_MUTEX(arena->mutex);
+	return block;
+}
+
+/**
+ * Return a block to the arena, for reuse by later allocations.
+ *
+ * @param arena arena the block was allocated from, NULL to use free()
+ * @param size size that the block was allocated with
+ */
+void arena_free(arena_t *arena, void *ptr, size_t size) {
+	if (arena == NULL) {
+		free(ptr);
+		return;
+	}
+	if (ptr == NULL)
+		return;
+	int class = arena_get_class(size);
+	SDL_LOCK_MUTEX(arena->mutex);
+	*(void **)ptr			= arena->free_list[class];
+	arena->free_list[class] = ptr;
+	arena->used -= (size_t)ARENA_BLOCK_MIN << class;
+	SDL_UNLOCK_MUTEX(arena->mutex);
+}
+
+/**
+ * Release all chunks of the arena at once. Blocks that weren't freed are released as well.
+ */
+void arena_destroy(arena_t *arena) {
+	if (arena == NULL)
+		return;
+	arena_chunk_t *chunk = arena->chunks;
+	while (chunk != NULL) {
+		arena_chunk_t *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	SDL_DestroyMutex(arena->mutex);
+	free(arena);
+}
@@ -0,0 +1,36 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-11.
+
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+
+typedef struct arena_chunk_t {
+	struct arena_chunk_t *next; //!< Next chunk in the arena
+	size_t size;				//!< Usable size of the chunk (bytes)
+	size_t used;				//!< Number of bytes carved out of the chunk
+} arena_chunk_t;
+
+typedef struct arena_t {
+	SDL_mutex *mutex;				//!< Mutex locking the arena (created upfront)
+	arena_chunk_t *chunks;			//!< Chunks allocated from the system (the first one is being carved)
+	void *free_list[ARENA_CLASSES]; //!< Freed blocks of each size class, ready for reuse
+	size_t size;					//!< Number of bytes allocated from the system
+	size_t used;					//!< Number of bytes in live blocks
+	size_t used_max;				//!< Maximum number of bytes in live blocks
+} arena_t;
+
+#define ARENA_MALLOC(arena, ptr, size, err)                                                                            \
+	do {                                                                                                               \
+		ptr = arena_alloc(arena, size);                                                                                \
+		if (ptr == NULL) {                                                                                             \
+			LT_E("Arena allocation failed for '" #ptr "' (%llu bytes)", (unsigned long long)size);                     \
+			err;                                                                                                       \
+		}                                                                                                              \
+	} while (0)
+
+// arena.c
+arena_t *arena_init();
+void *arena_alloc(arena_t *arena, size_t size);
+void arena_free(arena_t *arena, void *ptr, size_t size);
+void arena_destroy(arena_t *arena);
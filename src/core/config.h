@@ -28,8 +28,24 @@
 
 #define GFX_MAX_FONTS 10
 
-#define GAME_NAME_LEN	   24
-#define GAME_KEY_LEN	   6
-#define GAME_COUNTDOWN_SEC 3
-#define PLAYER_NAME_LEN	   24
-#define PLAYER_POS_NUM	   100
+#define GAME_NAME_LEN		   24
+#define GAME_KEY_LEN		   6
+#define GAME_COUNTDOWN_SEC	   3
+#define GAME_PLAYERS_MAX	   90
+#define PLAYER_NAME_LEN		   24
+#define PLAYER_TRAIL_NUM	   100
+#define PLAYER_KEYPRESS_NUM	   32
+#define PLAYER_BATCH_MAX	   64
+#define MATCH_LATE_BUCKETS	   8
+#define MATCH_SCHED_BATCH	   64
+#define REPLAY_KEYFRAME_TICKS  50
+#define MATCH_HASH_INTERVAL	   20
+#define MATCH_HASH_DELAY	   100
+#define SPECTATE_FRAME_PLAYERS 16
+#define TRACK_NAME_LEN		   24
+#define TRACK_GRID_SCALE	   2
+#define TRACK_GATE_MARGIN	   8
+#define ARENA_CHUNK_SIZE	   65536
+#define ARENA_CLASSES		   16
+#define CLUSTER_ADDRESS_LEN	   62
+#define CLUSTER_SYNC_MS		   1000
@@ -20,6 +20,18 @@ void settings_load() {
 	SETTINGS->tls_cert_file			= strdup("server.crt");
 	SETTINGS->tls_key_file			= strdup("server.key");
 	SETTINGS->net_slowdown			= false;
+	SETTINGS->rollback_ticks		= 200;
+	SETTINGS->match_workers			= 0;
+	SETTINGS->timing_precise		= true;
+	SETTINGS->timing_spin_us		= 200;
+	SETTINGS->replay_dir			= NULL;
+	SETTINGS->spectate_rate			= 20;
+	SETTINGS->track_file			= NULL;
+	SETTINGS->game_pool_low			= 2;
+	SETTINGS->game_pool_high		= 8;
+	SETTINGS->handoff_socket		= NULL;
+	SETTINGS->cluster_secret		= NULL;
+	SETTINGS->vsync				= false;
 
 	cJSON *json = file_read_json("settings.json");
 	if (json == NULL)
@@ -39,6 +51,18 @@ void settings_load() {
 	json_read_string(json, "tls_cert_file", &SETTINGS->tls_cert_file);
 	json_read_string(json, "tls_key_file", &SETTINGS->tls_key_file);
 	json_read_bool(json, "net_slowdown", &SETTINGS->net_slowdown);
+	json_read_int(json, "rollback_ticks", &SETTINGS->rollback_ticks);
+	json_read_int(json, "match_workers", &SETTINGS->match_workers);
+	json_read_bool(json, "timing_precise", &SETTINGS->timing_precise);
+	json_read_int(json, "timing_spin_us", &SETTINGS->timing_spin_us);
+	json_read_string(json, "replay_dir", &SETTINGS->replay_dir);
+	json_read_int(json, "spectate_rate", &SETTINGS->spectate_rate);
+	json_read_string(json, "track_file", &SETTINGS->track_file);
+	json_read_int(json, "game_pool_low", &SETTINGS->game_pool_low);
+	json_read_int(json, "game_pool_high", &SETTINGS->game_pool_high);
+	json_read_string(json, "handoff_socket", &SETTINGS->handoff_socket);
+	json_read_string(json, "cluster_secret", &SETTINGS->cluster_secret);
+	json_read_bool(json, "vsync", &SETTINGS->vsync);
 
 	LT_I("Loaded settings:");
 	LT_I(" - loglevel: %d", SETTINGS->loglevel);
@@ -54,6 +78,18 @@ void settings_load() {
 	LT_I(" - tls_cert_file: \"%s\"", SETTINGS->tls_cert_file);
 	LT_I(" - tls_key_file: \"%s\"", SETTINGS->tls_key_file);
 	LT_I(" - net_slowdown: %s", SETTINGS->net_slowdown ? "true" : "false");
+	LT_I(" - rollback_ticks: %d", SETTINGS->rollback_ticks);
+	LT_I(" - match_workers: %d", SETTINGS->match_workers);
+	LT_I(" - timing_precise: %s", SETTINGS->timing_precise ? "true" : "false");
+	LT_I(" - timing_spin_us: %d", SETTINGS->timing_spin_us);
+	LT_I(" - replay_dir: \"%s\"", SETTINGS->replay_dir);
+	LT_I(" - spectate_rate: %d", SETTINGS->spectate_rate);
+	LT_I(" - track_file: \"%s\"", SETTINGS->track_file);
+	LT_I(" - game_pool_low: %d", SETTINGS->game_pool_low);
+	LT_I(" - game_pool_high: %d", SETTINGS->game_pool_high);
+	LT_I(" - handoff_socket: \"%s\"", SETTINGS->handoff_socket);
+	LT_I(" - cluster_secret: %s", SETTINGS->cluster_secret ? "(set)" : "(null)");
+	LT_I(" - vsync: %s", SETTINGS->vsync ? "true" : "false");
 
 	cJSON_Delete(json);
 }
@@ -74,6 +110,18 @@ bool settings_save() {
 	cJSON_AddStringToObject(json, "tls_cert_file", SETTINGS->tls_cert_file);
 	cJSON_AddStringToObject(json, "tls_key_file", SETTINGS->tls_key_file);
 	cJSON_AddBoolToObject(json, "net_slowdown", SETTINGS->net_slowdown);
+	cJSON_AddNumberToObject(json, "rollback_ticks", SETTINGS->rollback_ticks);
+	cJSON_AddNumberToObject(json, "match_workers", SETTINGS->match_workers);
+	cJSON_AddBoolToObject(json, "timing_precise", SETTINGS->timing_precise);
+	cJSON_AddNumberToObject(json, "timing_spin_us", SETTINGS->timing_spin_us);
+	cJSON_AddStringToObject(json, "replay_dir", SETTINGS->replay_dir);
+	cJSON_AddNumberToObject(json, "spectate_rate", SETTINGS->spectate_rate);
+	cJSON_AddStringToObject(json, "track_file", SETTINGS->track_file);
+	cJSON_AddNumberToObject(json, "game_pool_low", SETTINGS->game_pool_low);
+	cJSON_AddNumberToObject(json, "game_pool_high", SETTINGS->game_pool_high);
+	cJSON_AddStringToObject(json, "handoff_socket", SETTINGS->handoff_socket);
+	cJSON_AddStringToObject(json, "cluster_secret", SETTINGS->cluster_secret);
+	cJSON_AddBoolToObject(json, "vsync", SETTINGS->vsync);
 
 	bool ret = file_write_json("settings.json", json);
 	cJSON_Delete(json);
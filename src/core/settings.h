@@ -26,6 +26,18 @@ typedef struct {
 	RSA *tls_key;
 
 	bool net_slowdown;
+	int rollback_ticks;
+	int match_workers;
+	bool timing_precise;
+	int timing_spin_us;
+	char *replay_dir;
+	int spectate_rate;
+	char *track_file;
+	int game_pool_low;
+	int game_pool_high;
+	char *handoff_socket;
+	char *cluster_secret;
+	bool vsync;
 } settings_t;
 
 void settings_load();
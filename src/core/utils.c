@@ -60,6 +60,39 @@ unsigned long long millis() {
 	return (unsigned long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
 
+/**
+ * Sleep until an absolute SDL_GetPerformanceCounter() deadline.
+ * Sleep to an absolute CLOCK_MONOTONIC time with clock_nanosleep() on Linux
+ * (SDL_Delay() elsewhere), then busy-wait for the last 'spin_us' microseconds.
+ */
+void perf_sleep_until(uint64_t deadline, unsigned int spin_us) {
+	uint64_t perf_freq = SDL_GetPerformanceFrequency();
+	uint64_t perf_cur  = SDL_GetPerformanceCounter();
+	uint64_t perf_spin = perf_freq * spin_us / 1000000;
+	if (perf_cur + perf_spin < deadline) {
+		uint64_t perf_diff = deadline - perf_spin - perf_cur;
+		uint64_t sleep_ns  = perf_diff / perf_freq * 1000000000 + perf_diff % perf_freq * 1000000000 / perf_freq;
+#if defined(__linux__)
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_sec += (time_t)(sleep_ns / 1000000000);
+		ts.tv_nsec += (long)(sleep_ns % 1000000000);
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+			/* sleep again if interrupted */
+		}
+#else
+		SDL_Delay((uint32_t)(sleep_ns / 1000000));
+#endif
+	}
+	while (SDL_GetPerformanceCounter() < deadline) {
+		/* spin until the deadline */
+	}
+}
+
 void SDL_SemReset(SDL_sem *sem) {
 	while (SDL_SemTryWait(sem) == 0) {
 		/* reset the semaphore */
@@ -151,6 +184,13 @@ void json_read_int(cJSON *json, const char *key, int *value) {
 	*value = item->valueint;
 }
 
+void json_read_double(cJSON *json, const char *key, double *value) {
+	cJSON *item = cJSON_GetObjectItem(json, key);
+	if (!cJSON_IsNumber(item) || value == NULL)
+		return;
+	*value = item->valuedouble;
+}
+
 void json_read_bool(cJSON *json, const char *key, bool *value) {
 	cJSON *item = cJSON_GetObjectItem(json, key);
 	if (value == NULL)
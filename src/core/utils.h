@@ -80,6 +80,7 @@ void hexdump(const void *buf, size_t len);
 int posix_gettimeofday(struct timeval *tp, void *tzp);
 #endif
 unsigned long long millis();
+void perf_sleep_until(uint64_t deadline, unsigned int spin_us);
 void SDL_SemReset(SDL_sem *sem);
 char *strncpy2(char *dest, const char *src, size_t count);
 char *file_read_data(const char *filename);
@@ -89,6 +90,7 @@ bool file_write_json(const char *filename, cJSON *json);
 void json_read_string(cJSON *json, const char *key, char **value);
 void json_read_uint(cJSON *json, const char *key, unsigned int *value);
 void json_read_int(cJSON *json, const char *key, int *value);
+void json_read_double(cJSON *json, const char *key, double *value);
 void json_read_bool(cJSON *json, const char *key, bool *value);
 void json_read_gfx_size(cJSON *json, const char *key, int *value);
 void json_read_gfx_align(cJSON *json, const char *key, int *value);
@@ -0,0 +1,53 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-15.
+
+#include "include.h"
+
+static SDL_atomic_t wakeup_pending = {0}; //!< Whether a wakeup event is waiting in the SDL event queue
+static SDL_atomic_t wakeup_match   = {0}; //!< Match updates raised since the last wakeup (1 << MATCH_UPDATE_*)
+
+/**
+ * Wake up the UI thread, to make it pull the shared state (queued packets, match updates).
+ *
+ * Only one SDL_USEREVENT_WAKEUP event is in the SDL event queue at a time, regardless of how
+ * many updates are raised before the UI processes it - so game and match threads never flood
+ * the (fixed-size) event queue.
+ */
+void wakeup_ui() {
+	if (SDL_AtomicCAS(&wakeup_pending, 0, 1)) {
+		SDL_Event event = {
+			.user.type = SDL_USEREVENT_WAKEUP,
+		};
+		if (SDL_PushEvent(&event) != 1)
+			// allow trying again later
+			SDL_AtomicSet(&wakeup_pending, 0);
+	}
+}
+
+/**
+ * Raise a match update (MATCH_UPDATE_*) and wake up the UI thread. Updates raised
+ * multiple times before the UI pulls them are only processed once.
+ */
+void wakeup_ui_match(int code) {
+	int codes;
+	do {
+		codes = SDL_AtomicGet(&wakeup_match);
+	} while (!SDL_AtomicCAS(&wakeup_match, codes, codes | (1 << code)));
+	wakeup_ui();
+}
+
+/**
+ * UI thread: acknowledge the wakeup event. Must be called before pulling the shared state,
+ * so that any updates raised afterwards send another wakeup event.
+ */
+void wakeup_ack() {
+	SDL_AtomicSet(&wakeup_pending, 0);
+}
+
+/**
+ * UI thread: take all raised match updates.
+ *
+ * @return bit mask of MATCH_UPDATE_* codes (1 << code)
+ */
+int wakeup_take_match() {
+	return SDL_AtomicSet(&wakeup_match, 0);
+}
@@ -0,0 +1,10 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-15.
+
+#pragma once
+
+#include <SDL2/SDL.h>
+
+void wakeup_ui();
+void wakeup_ui_match(int code);
+void wakeup_ack();
+int wakeup_take_match();
@@ -10,7 +10,7 @@ static void game_check_empty(game_t *game, bool endpoint_deleted);
  */
 void game_add_endpoint(game_t *game, net_endpoint_t *endpoint) {
 	// this needs to be thread-safe - it's used in net_client and net_server
-	net_endpoint_t *item = net_endpoint_dup(endpoint);
+	net_endpoint_t *item = net_endpoint_dup(endpoint, game->arena);
 	if (item == NULL)
 		return;
 	LT_I("Game: adding endpoint %s", net_endpoint_str(endpoint));
@@ -39,9 +39,15 @@ void game_add_endpoint(game_t *game, net_endpoint_t *endpoint) {
 void game_del_endpoint(game_t *game, net_endpoint_t *endpoint) {
 	LT_I("Game: deleting endpoint %s", net_endpoint_str(endpoint));
 	net_endpoint_type_t type = endpoint->type;
+	if (endpoint == game->upstream) {
+		// relay: nothing to mirror anymore
+		LT_E("Game: upstream server disconnected");
+		game->upstream = NULL;
+		game->stop	   = true;
+	}
 	DL_DELETE(game->endpoints, endpoint);
 	net_endpoint_free(endpoint);
-	free(endpoint);
+	arena_free(game->arena, endpoint, sizeof(*endpoint));
 	// check if game is empty
 	game_check_empty(game, true);
 	if (type == NET_ENDPOINT_PIPE || game->stop)
@@ -80,6 +86,9 @@ void game_add_player(game_t *game, player_t *player) {
  */
 void game_del_player(game_t *game, player_t *player) {
 	net_endpoint_t *player_endpoint = player->endpoint;
+	if (player->state == PLAYER_SPECTATING && player_endpoint != NULL)
+		// the endpoint doesn't need spectator frames for this player anymore
+		player_endpoint->spectators--;
 	if ((player->state & PLAYER_IN_MATCH_MASK) == 0) {
 		// player can be deleted safely
 		LT_I("Game: deleting player #%d '%s'", player->id, player->name);
@@ -101,8 +110,8 @@ void game_del_player(game_t *game, player_t *player) {
 		}
 	}
 
-	// post the ready state semaphore
-	SDL_SemPost(game->ready_sem);
+	// wake up the match waiting for ready state
+	match_wake(game);
 
 	// search any other players on the same endpoint
 	if (player_endpoint == NULL)
@@ -3,43 +3,52 @@
 #include "game.h"
 
 static int game_thread(game_t *game);
+static void game_loop(game_t *game);
 static net_err_t game_select_read_cb(net_endpoint_t *endpoint, game_t *game);
 static void game_select_err_cb(net_endpoint_t *endpoint, game_t *game, net_err_t err);
 
 static game_t *game_list		  = NULL;
 static SDL_mutex *game_list_mutex = NULL;
 
+static void game_set_defaults(game_t *game) {
+	game->is_public = false;
+	game->speed		= SETTINGS->game_speed;
+	game->state		= GAME_IDLE;
+	game->rounds	= 15;
+	match_snapshot_init(game);
+}
+
 game_t *game_init(pkt_game_data_t *pkt_data) {
+	game_t *game = game_create(pkt_data);
+	if (game != NULL && game->is_server)
+		game_activate(game);
+	return game;
+}
+
+/**
+ * Create a game and start its thread. Server games are not listed (nor joinable)
+ * until game_activate() is called - until then, they can be kept in the game pool.
+ */
+game_t *game_create(pkt_game_data_t *pkt_data) {
+	// the game's objects are allocated from its arena, and released at once in game_free()
+	arena_t *arena = arena_init();
+	if (arena == NULL)
+		return NULL;
 	game_t *game;
-	MALLOC(game, sizeof(*game), goto cleanup);
+	ARENA_MALLOC(arena, game, sizeof(*game), arena_destroy(arena); return NULL);
+	game->arena = arena;
 
 	SDL_WITH_MUTEX(game->mutex) {
-		// create an expiry timer (initially 5000 ms)
-		game->expiry_timer = SDL_AddTimer(5000, (SDL_TimerCallback)game_expiry_cb, game);
-		// create semaphores
-		game->ready_sem	   = SDL_CreateSemaphore(0);
-		game->start_at_sem = SDL_CreateSemaphore(0);
 		// set some default settings
-		game->is_public = false;
-		game->speed		= SETTINGS->game_speed;
-		game->state		= GAME_IDLE;
-		game->rounds	= 15;
+		game_set_defaults(game);
 
 		if (pkt_data == NULL) {
 			// new game created, set the server's default options
 			game->is_server = true;
 			game_set_default_player_options(game);
-			// generate a game key
-			do {
-				char *ch = game->key;
-				for (int i = 0; i < sizeof(game->key) - 1; i++) {
-					int num = '0' + rand() % 36;
-					if (num > '9')
-						num += 'A' - '9' - 1;
-					*ch++ = (char)num;
-				}
-			} while (game_get_by_key(game->key) != NULL);
 		} else {
+			// create an expiry timer (initially 5000 ms)
+			game->expiry_timer = SDL_AddTimer(5000, (SDL_TimerCallback)game_expiry_cb, game);
 			// joined a game, apply data from PKT_GAME_DATA
 			game_process_packet(game, (pkt_t *)pkt_data, NULL);
 			// fetch the local IP addresses (for UI)
@@ -62,13 +71,6 @@ game_t *game_init(pkt_game_data_t *pkt_data) {
 	if (thread == NULL)
 		SDL_ERROR("SDL_CreateThread()", goto cleanup);
 
-	if (game->is_server) {
-		// only use game_list server-side
-		SDL_WITH_MUTEX(game_list_mutex) {
-			DL_APPEND(game_list, game);
-		}
-	}
-
 	return game;
 
 cleanup:
@@ -76,6 +78,79 @@ cleanup:
 	return NULL;
 }
 
+/**
+ * Server: generate a key for the game and add it to the game list, so that it can be joined.
+ * The game expires if nobody joins it within 5000 ms.
+ */
+void game_activate(game_t *game) {
+	SDL_WITH_MUTEX(game->mutex) {
+		// create an expiry timer (initially 5000 ms)
+		game->expiry_timer = SDL_AddTimer(5000, (SDL_TimerCallback)game_expiry_cb, game);
+		// generate a game key
+		do {
+			char *ch = game->key;
+			for (int i = 0; i < sizeof(game->key) - 1; i++) {
+				int num = '0' + rand() % 36;
+				if (num > '9')
+					num += 'A' - '9' - 1;
+				*ch++ = (char)num;
+			}
+			// cluster node: the first character is the node's shard
+			if (net_cluster_shard_char() != '\0')
+				game->key[0] = net_cluster_shard_char();
+		} while (game_get_by_key(game->key) != NULL);
+	}
+	// only use game_list server-side
+	SDL_WITH_MUTEX(game_list_mutex) {
+		DL_APPEND(game_list, game);
+		game->is_listed = true;
+	}
+}
+
+/**
+ * Server: reset a stopped game to the state of a newly created one, keeping its thread,
+ * pipe, mutex and arena. The game is removed from the game list. Must be called by the game thread.
+ */
+void game_reset(game_t *game) {
+	SDL_WITH_MUTEX(game_list_mutex) {
+		if (game->is_listed)
+			DL_DELETE(game_list, game);
+		game->is_listed = false;
+	}
+	match_stop(game);
+	SDL_WITH_MUTEX(game->mutex) {
+		// close and free all endpoints but the pipe
+		net_endpoint_t *endpoint, *endpoint_tmp;
+		DL_FOREACH_SAFE(game->endpoints, endpoint, endpoint_tmp) {
+			if (endpoint->type == NET_ENDPOINT_PIPE)
+				continue;
+			DL_DELETE(game->endpoints, endpoint);
+			net_endpoint_free(endpoint);
+			SDL_DestroyMutex(endpoint->mutex);
+			arena_free(game->arena, endpoint, sizeof(*endpoint));
+		}
+		// free all players
+		player_t *player, *player_tmp;
+		DL_FOREACH_SAFE(game->players, player, player_tmp) {
+			DL_DELETE(game->players, player);
+			player_free(player);
+		}
+		match_snapshot_free(game);
+		SDL_RemoveTimer(game->expiry_timer);
+
+		// clear everything else
+		game_t clean = {
+			.mutex	   = game->mutex,
+			.arena	   = game->arena,
+			.endpoints = game->endpoints,
+			.is_server = true,
+		};
+		*game = clean;
+		game_set_defaults(game);
+		game_set_default_player_options(game);
+	}
+}
+
 game_t *game_get_list(SDL_mutex **mutex) {
 	if (mutex != NULL)
 		*mutex = game_list_mutex;
@@ -104,12 +179,12 @@ void game_free(game_t *game) {
 	if (game == NULL)
 		return;
 	// remove the game from the global list
-	if (game->is_server) {
-		SDL_WITH_MUTEX(game_list_mutex) {
+	SDL_WITH_MUTEX(game_list_mutex) {
+		if (game->is_listed)
 			DL_DELETE(game_list, game);
-		}
+		game->is_listed = false;
 	}
-	// stop the match thread
+	// stop the match
 	match_stop(game);
 	// close and free all endpoints
 	SDL_WITH_MUTEX(game->mutex) {
@@ -118,7 +193,7 @@ void game_free(game_t *game) {
 			DL_DELETE(game->endpoints, endpoint);
 			net_endpoint_free(endpoint);
 			SDL_DestroyMutex(endpoint->mutex);
-			free(endpoint);
+			arena_free(game->arena, endpoint, sizeof(*endpoint));
 		}
 	}
 	// free all players
@@ -130,12 +205,18 @@ void game_free(game_t *game) {
 		}
 	}
 	// free remaining members
+	match_snapshot_free(game);
 	SDL_DestroyMutex(game->mutex);
-	SDL_DestroySemaphore(game->ready_sem);
-	SDL_DestroySemaphore(game->start_at_sem);
 	SDL_RemoveTimer(game->expiry_timer);
 	free(game->local_ips);
-	free(game);
+	arena_t *arena = game->arena;
+	LT_I(
+		"Game: freed '%s' (arena: %llu bytes, %llu bytes in use at peak)",
+		game->name,
+		(unsigned long long)arena->size,
+		(unsigned long long)arena->used_max
+	);
+	arena_destroy(arena);
 }
 
 static int game_thread(game_t *game) {
@@ -146,6 +227,17 @@ static int game_thread(game_t *game) {
 	lt_log_set_thread_name(thread_name);
 	srand((unsigned int)time(NULL));
 
+	do {
+		game_loop(game);
+		// server: keep the thread running for a new room, if the pool needs it
+	} while (game->is_server && game_pool_recycle(game));
+
+	game_free(game);
+	LT_I("Game: thread stopped");
+	return 0;
+}
+
+static void game_loop(game_t *game) {
 	LT_I("Game: starting '%s' (key: %s)", game->name, game->key);
 
 	while (!game->stop) {
@@ -163,19 +255,19 @@ static int game_thread(game_t *game) {
 			SDL_Delay(100);
 
 		// server: check if all players are ready now
-		if (game->is_server && game->state == GAME_IDLE && match_check_ready(game) && !game->match_stop &&
-			!game->stop) {
+		if (game->is_server && game->upstream == NULL && game->state == GAME_IDLE && match_check_ready(game) &&
+			!game->match_stop && !game->stop) {
 			// start the match
 			game->state = GAME_STARTING;
-			if (game->match_thread != NULL) {
-				// if there is a running match thread, quit
-				LT_E("Game: match thread already running");
+			if (game->match_scheduled) {
+				// if there is a running match, quit
+				LT_E("Game: match already running");
 				game_send_error(game, NULL, GAME_ERR_SERVER_ERROR);
 				goto cleanup;
 			}
 			if (!match_init(game)) {
-				// if thread creation failed, quit
-				LT_E("Game: match thread creation failed");
+				// if scheduling failed, quit
+				LT_E("Game: match scheduling failed");
 				game_send_error(game, NULL, GAME_ERR_SERVER_ERROR);
 				goto cleanup;
 			}
@@ -193,9 +285,6 @@ cleanup:
 		SDL_PushEvent(&event);
 	}
 	LT_I("Game: stopping '%s' (key: %s)", game->name, game->key);
-	game_free(game);
-	LT_I("Game: thread stopped");
-	return 0;
 }
 
 static net_err_t game_select_read_cb(net_endpoint_t *endpoint, game_t *game) {
@@ -11,6 +11,9 @@ typedef struct pkt_game_data_t pkt_game_data_t;
 
 // game.c
 game_t *game_init(pkt_game_data_t *pkt_data);
+game_t *game_create(pkt_game_data_t *pkt_data);
+void game_activate(game_t *game);
+void game_reset(game_t *game);
 game_t *game_get_list(SDL_mutex **mutex);
 uint32_t game_expiry_cb(uint32_t interval, game_t *game);
 void game_stop(game_t *game);
@@ -39,3 +42,13 @@ game_t *game_get_by_key(char *key);
 
 // packet.c
 bool game_process_packet(game_t *game, pkt_t *pkt, net_endpoint_t *source);
+
+// pool.c
+bool game_pool_start();
+game_t *game_pool_claim();
+bool game_pool_recycle(game_t *game);
+void game_pool_stop();
+
+// relay.c
+game_t *game_relay_start(const char *address, const char *key);
+bool game_relay_process_packet(game_t *game, pkt_t *pkt, net_endpoint_t *source, bool *broadcast);
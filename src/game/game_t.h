@@ -6,12 +6,16 @@
 
 typedef struct net_endpoint_t net_endpoint_t;
 typedef struct player_t player_t;
+typedef struct player_snapshot_t player_snapshot_t;
+typedef struct replay_rec_t replay_rec_t;
 
 typedef enum game_err_t {
 	GAME_ERR_OK			   = 0,	 //!< No error
 	GAME_ERR_INVALID_STATE = 1,	 //!< Operation invalid in the current game state
 	GAME_ERR_NOT_FOUND	   = 2,	 //!< Game not found by the specified key
 	GAME_ERR_NO_PLAYER	   = 3,	 //!< Player not found by the specified ID
+	GAME_ERR_FULL		   = 4,	 //!< No more players can join the game
+	GAME_ERR_RESTARTING	   = 5,	 //!< Server is restarting, new games are refused
 	GAME_ERR_SERVER_ERROR  = 99, //!< Internal server error
 } game_err_t;
 
@@ -23,18 +27,39 @@ typedef enum game_state_t {
 	GAME_FINISHED = 4, //!< Round finished
 } game_state_t;
 
+typedef enum match_phase_t {
+	MATCH_IDLE			= 0, //!< Match is not running
+	MATCH_INIT			= 1, //!< Match is starting
+	MATCH_ROUND_INIT	= 2, //!< Round is initializing
+	MATCH_PING_WAIT		= 3, //!< Waiting for clients' ping responses (server only)
+	MATCH_START_AT_WAIT = 4, //!< Waiting for 'start_at' from the server (client only)
+	MATCH_COUNTING		= 5, //!< Waiting for the countdown/counting down
+	MATCH_START_WAIT	= 6, //!< Waiting for the synchronized round start
+	MATCH_PLAYING		= 7, //!< Round playing
+	MATCH_READY_WAIT	= 8, //!< Round finished, waiting for players to be ready
+	MATCH_STOP			= 9, //!< Match is stopping
+} match_phase_t;
+
+typedef struct match_snapshot_t {
+	unsigned int tick;			//!< Sequence number of the snapshot
+	unsigned int count;			//!< Number of players in the snapshot
+	unsigned int size;			//!< Allocated player capacity
+	player_snapshot_t *players; //!< Players' state at the snapshot's tick
+} match_snapshot_t;
+
 typedef struct game_t {
 	SDL_mutex *mutex;		  //!< Mutex locking the game (players list and other options)
-	SDL_sem *ready_sem;		  //!< Semaphore for checking ready state by match thread
-	SDL_sem *start_at_sem;	  //!< Semaphore for signalling 'start_at' availability
 	SDL_TimerID expiry_timer; //!< Expiry timer for the game
 	bool stop;				  //!< Whether to stop the game thread
 	bool is_server;			  //!< Whether this game is servers other players (clients)
 	bool is_public;			  //!< Whether this game is public (searchable)
 	bool is_local;			  //!< Whether this game is served by/connected to a LAN server
+	bool is_listed;			  //!< Whether this game is in the game list (joinable, server only)
 	char *local_ips;		  //!< Local IP addresses (for UI, client-only)
+	arena_t *arena;			  //!< Arena holding the game, its endpoints and players (NULL: malloc())
 
 	net_endpoint_t *endpoints; //!< Communication pipe and other connected devices
+	net_endpoint_t *upstream;  //!< Server the game is mirrored from (relay only)
 	player_t *players;		   //!< Players in the room
 
 	// game options
@@ -51,8 +76,37 @@ typedef struct game_t {
 	unsigned int round;			 //!< Round number, 1..15
 	unsigned int rounds;		 //!< Total rounds for the game
 	unsigned int lap;			 //!< Lap number, 1..4
-	SDL_Thread *match_thread;	 //!< Match thread handle
-	bool match_stop;			 //!< Whether to stop the match thread
+	bool start_at_ready;		 //!< Whether 'count_at' and 'start_at' were received
+	bool match_stop;			 //!< Whether to stop the match
+
+	// match state machine, controlled by the match scheduler
+	match_phase_t match_phase;						 //!< Current match phase
+	uint64_t match_deadline;						 //!< Next step deadline (performance counter)
+	unsigned int match_heap_idx;					 //!< Index in the scheduler's deadline heap
+	bool match_scheduled;							 //!< Whether the match is in the scheduler (queued or running)
+	bool match_running;								 //!< Whether the match is being stepped by a worker
+	bool match_woken;								 //!< Whether the match was woken up while running
+	bool match_any_playing;							 //!< Whether any player was playing in the current round
+	unsigned long long ping_until;					 //!< Ping response timeout timestamp (server only)
+	uint64_t perf_loop_delay;						 //!< Tick duration (performance counter)
+	uint64_t perf_loop_next;						 //!< Next tick timestamp (performance counter)
+	uint64_t perf_ui_delay;							 //!< UI update interval (performance counter)
+	uint64_t perf_ui_next;							 //!< Next UI update timestamp (performance counter)
+	unsigned int tick_late_hist[MATCH_LATE_BUCKETS]; //!< Histogram of tick lateness in this round
+	unsigned int tick_late_max;						 //!< Maximum tick lateness in this round (us)
+	replay_rec_t *replay;							 //!< Replay recorder of the current round (if enabled)
+	unsigned int round_ticks;						 //!< Number of ticks played in this round
+	bool spectate_keyframe;							 //!< Whether to send a keyframe to spectators (server only)
+	unsigned int spectate_next;						 //!< Round-robin index of the next streamed player (server only)
+	unsigned int spectate_tick;						 //!< Round tick of the last received frame (client only)
+	unsigned int relay_next_id;						 //!< Next ID for the relay's own spectators (relay only)
+
+	// per-tick snapshots for the renderer (triple buffer, see match_snapshot_publish())
+	match_snapshot_t snapshot[3]; //!< Snapshot buffers
+	SDL_atomic_t snapshot_latest; //!< Index of the latest published snapshot (| MATCH_SNAPSHOT_FRESH)
+	unsigned int snapshot_write;  //!< Index of the snapshot being written (match thread only)
+	unsigned int snapshot_read;	  //!< Index of the snapshot being read (UI thread only)
+	unsigned int snapshot_tick;	  //!< Sequence number of the last published snapshot
 
 	struct game_t *prev, *next;
 } game_t;
@@ -2,8 +2,14 @@
 
 #include "match.h"
 
-static int match_thread(game_t *game);
-static void match_run(game_t *game);
+static void match_round_init(game_t *game);
+static void match_ping_check(game_t *game);
+static void match_count_wait(game_t *game);
+static void match_counting(game_t *game);
+static void match_start(game_t *game);
+static void match_tick(game_t *game);
+static void match_round_finish(game_t *game);
+static void match_sleep_until(game_t *game, unsigned long long timestamp);
 
 static const unsigned int ping_timeout		= 2000;
 static const unsigned int speed_to_delay[9] = {
@@ -17,72 +23,144 @@ static const unsigned int speed_to_delay[9] = {
 	2 * 5,	  // Speed 8
 	0 + 8,	  // Speed 9
 };
+// upper bounds of tick lateness histogram buckets (us)
+static const unsigned int tick_late_buckets[MATCH_LATE_BUCKETS - 1] = {50, 100, 250, 500, 1000, 2000, 5000};
 
 bool match_init(game_t *game) {
-	// reset the 'start_at' semaphore
-	SDL_SemReset(game->start_at_sem);
-	game->match_stop = false;
-
-	// start the match thread
-	SDL_Thread *thread = SDL_CreateThread((SDL_ThreadFunction)match_thread, "match", game);
-	game->match_thread = thread;
-	if (thread == NULL)
-		SDL_ERROR("SDL_CreateThread()", return false);
+	// reset the 'start_at' flag
+	SDL_WITH_MUTEX(game->mutex) {
+		game->start_at_ready = false;
+	}
 
-	return true;
+	// add the match to the scheduler (fails if it's already scheduled)
+	return match_sched_add(game);
 }
 
 void match_stop(game_t *game) {
-	if (game->match_thread == NULL)
-		return;
-	// wake up the match thread, wait for it to quit
-	game->match_stop = true;
-	SDL_SemPost(game->start_at_sem);
-	SDL_SemPost(game->ready_sem);
-	SDL_WaitThread(game->match_thread, NULL);
-	game->match_thread = NULL;
-	game->match_stop   = false;
+	// wake up the match, wait for it to quit
+	match_sched_remove(game);
+	game->match_phase = MATCH_IDLE;
+	game->match_stop  = false;
 }
 
-static int match_thread(game_t *game) {
-	char thread_name[20];
-	snprintf(thread_name, sizeof(thread_name), "match-%s-%s", game->is_server ? "server" : "client", game->key);
-	lt_log_set_thread_name(thread_name);
-	srand((unsigned int)time(NULL));
-
-	LT_I("Match: starting match in game '%s' (%s)", game->name, game->key);
-
-	// server: send game start signal
-	if (game->is_server) {
-		pkt_game_start_t pkt = {
-			.hdr.type = PKT_GAME_START,
-		};
-		net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
+/**
+ * Run a single step of the match state machine.
+ * Called by the scheduler once the match's deadline passes, or when the match is woken up by an event.
+ * Each step sets the next phase and deadline; waiting phases are re-checked on every wake-up.
+ *
+ * @return false if the match has finished (and should be removed from the scheduler)
+ */
+bool match_step(game_t *game) {
+	if (game->match_stop && game->match_phase != MATCH_STOP) {
+		// finish the current round if it's playing
+		if (game->match_phase == MATCH_PLAYING)
+			match_round_finish(game);
+		game->match_phase = MATCH_STOP;
 	}
 
-	player_t *player;
-	DL_FOREACH(game->players, player) {
-		player->match_points = 0;
+	// record how late the tick started
+	uint64_t perf_cur = SDL_GetPerformanceCounter();
+	if (game->match_phase == MATCH_PLAYING && perf_cur > game->match_deadline) {
+		unsigned int late = (perf_cur - game->match_deadline) * 1000000 / SDL_GetPerformanceFrequency();
+		unsigned int i	  = 0;
+		while (i < MATCH_LATE_BUCKETS - 1 && late >= tick_late_buckets[i]) {
+			i++;
+		}
+		game->tick_late_hist[i]++;
+		game->tick_late_max = max(game->tick_late_max, late);
+	} else if (game->match_phase == MATCH_PLAYING) {
+		game->tick_late_hist[0]++;
 	}
 
-	for (game->round = 1; game->round <= game->rounds && !game->match_stop;) {
-		match_run(game);
-		match_wait_ready(game);
-	}
+	// run the next step immediately, unless the phase says otherwise
+	game->match_deadline = perf_cur;
+
+	switch (game->match_phase) {
+		case MATCH_IDLE:
+			return false;
+
+		case MATCH_INIT: {
+			LT_I("Match: starting match in game '%s' (%s)", game->name, game->key);
+			// server: send game start signal
+			if (game->is_server) {
+				pkt_game_start_t pkt = {
+					.hdr.type = PKT_GAME_START,
+				};
+				net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
+			}
+			player_t *player;
+			DL_FOREACH(game->players, player) {
+				player->match_points = 0;
+			}
+			game->round		  = 1;
+			game->match_phase = MATCH_ROUND_INIT;
+			break;
+		}
 
-	// server: send game stop signal
-	LT_I("Match: thread stopping");
-	if (game->is_server) {
-		pkt_game_stop_t pkt = {
-			.hdr.type = PKT_GAME_STOP,
-		};
-		net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
-	}
+		case MATCH_ROUND_INIT:
+			if (game->round > game->rounds) {
+				game->match_phase = MATCH_STOP;
+				break;
+			}
+			match_round_init(game);
+			break;
+
+		case MATCH_PING_WAIT:
+			match_ping_check(game);
+			break;
+
+		case MATCH_START_AT_WAIT:
+			// client: wait for 'start_at' packet from server
+			SDL_WITH_MUTEX(game->mutex) {
+				if (game->start_at_ready) {
+					game->start_at_ready = false;
+					game->match_phase	 = MATCH_COUNTING;
+				}
+			}
+			if (game->match_phase == MATCH_COUNTING)
+				match_count_wait(game);
+			else
+				game->match_deadline = MATCH_DEADLINE_NONE;
+			break;
+
+		case MATCH_COUNTING:
+			match_counting(game);
+			break;
 
-	return 0;
+		case MATCH_START_WAIT:
+			match_start(game);
+			break;
+
+		case MATCH_PLAYING:
+			match_tick(game);
+			break;
+
+		case MATCH_READY_WAIT:
+			if (match_check_ready(game)) {
+				game->match_phase = MATCH_ROUND_INIT;
+				break;
+			}
+			// wait for any player's state to change
+			LT_I("Match (round %u): players are not ready", game->round);
+			game->match_deadline = MATCH_DEADLINE_NONE;
+			break;
+
+		case MATCH_STOP:
+			// server: send game stop signal
+			LT_I("Match: stopping");
+			if (game->is_server) {
+				pkt_game_stop_t pkt = {
+					.hdr.type = PKT_GAME_STOP,
+				};
+				net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
+			}
+			game->match_phase = MATCH_IDLE;
+			return false;
+	}
+	return true;
 }
 
-static void match_run(game_t *game) {
+static void match_round_init(game_t *game) {
 	LT_I("Match (round %u): initializing round", game->round);
 
 	SDL_WITH_MUTEX(game->mutex) {
@@ -91,80 +169,93 @@ static void match_run(game_t *game) {
 		game->lap	= 1;
 		// reset player's data, set as PLAYING
 		player_reset_round(game);
+		// publish the new round's state for the UI
+		match_snapshot_publish(game);
 	}
 
 	// make the UI redraw everything
 	game->state = GAME_STARTING;
-	match_send_sdl_event(game, MATCH_UPDATE_REDRAW_ALL);
+	match_send_ui_update(game, MATCH_UPDATE_REDRAW_ALL);
 
-	unsigned long long count_at = 0, start_at = 0;
+	if (!game->is_server) {
+		// client: wait for 'start_at' packet from server
+		game->match_phase = MATCH_START_AT_WAIT;
+		return;
+	}
 
-	if (game->is_server) {
-		// server: ping all clients
-		net_endpoint_t *endpoint, *tmp;
-		// create endpoint ping semaphores, reset them to 0
-		DL_FOREACH_SAFE(game->endpoints, endpoint, tmp) {
-			if (endpoint->type == NET_ENDPOINT_PIPE)
-				continue;
-			if (endpoint->ping_sem == NULL)
-				endpoint->ping_sem = SDL_CreateSemaphore(0);
-			SDL_SemReset(endpoint->ping_sem);
-		}
-		// request ping-based time sync for every endpoint
-		game_request_time_sync(game);
-		// wait for all clients to report their RTT
-		int endpoints_ok	 = 0;
-		unsigned int max_rtt = 0;
-		DL_FOREACH_SAFE(game->endpoints, endpoint, tmp) {
-			if (endpoint->type == NET_ENDPOINT_PIPE)
-				continue;
-			if (SDL_SemWaitTimeout(endpoint->ping_sem, ping_timeout) == 0) {
-				max_rtt = max(max_rtt, endpoint->ping_rtt);
-				endpoints_ok++;
-			} else {
-				// endpoint didn't respond, disconnect it
-				LT_W(
-					"Match (round %u): ping timed out after %u ms - disconnecting %s",
-					game->round,
-					ping_timeout,
-					net_endpoint_str(endpoint)
-				);
-				net_endpoint_close(endpoint);
-			}
-			if (game->match_stop)
-				return;
-		}
+	// server: ping all clients
+	net_endpoint_t *endpoint;
+	DL_FOREACH(game->endpoints, endpoint) {
+		endpoint->ping_ok = false;
+	}
+	// request ping-based time sync for every endpoint
+	game_request_time_sync(game);
+	// wait for all clients to report their RTT
+	game->ping_until  = millis() + ping_timeout;
+	game->match_phase = MATCH_PING_WAIT;
+	match_sleep_until(game, game->ping_until);
+}
+
+static void match_ping_check(game_t *game) {
+	net_endpoint_t *endpoint, *tmp;
+	bool all_ok = true;
+	DL_FOREACH(game->endpoints, endpoint) {
+		if (endpoint->type != NET_ENDPOINT_PIPE && !endpoint->ping_ok)
+			all_ok = false;
+	}
+	if (!all_ok && millis() < game->ping_until) {
+		// wait for more responses, or the timeout
+		match_sleep_until(game, game->ping_until);
+		return;
+	}
 
-		if (endpoints_ok == 0) {
-			LT_W("Match (round %u): no endpoints responded! Stopping the thread", game->round);
-			game->match_stop = true;
-			return;
+	int endpoints_ok	 = 0;
+	unsigned int max_rtt = 0;
+	DL_FOREACH_SAFE(game->endpoints, endpoint, tmp) {
+		if (endpoint->type == NET_ENDPOINT_PIPE)
+			continue;
+		if (endpoint->ping_ok) {
+			max_rtt = max(max_rtt, endpoint->ping_rtt);
+			endpoints_ok++;
+		} else {
+			// endpoint didn't respond, disconnect it
+			LT_W(
+				"Match (round %u): ping timed out after %u ms - disconnecting %s",
+				game->round,
+				ping_timeout,
+				net_endpoint_str(endpoint)
+			);
+			net_endpoint_close(endpoint);
 		}
+	}
 
-		LT_I("Match (round %u): all clients' ping check finished", game->round);
-
-		// calculate the local timestamp based on max RTT of all endpoints
-		// add 100 ms (overhead)
-		count_at = millis() + max_rtt + 100;
-		// calculate the actual match start timestamp
-		// add the countdown timer
-		start_at = count_at + GAME_COUNTDOWN_SEC * 1000;
-		// send to clients
-		pkt_game_start_round_t pkt = {
-			.hdr.type = PKT_GAME_START_ROUND,
-			.count_at = count_at,
-			.start_at = start_at,
-		};
-		net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
-	} else {
-		// client: wait for 'start_at' packet from server
-		SDL_SemWait(game->start_at_sem);
-		if (game->match_stop)
-			return;
-		count_at = game->count_at;
-		start_at = game->start_at;
+	if (endpoints_ok == 0) {
+		LT_W("Match (round %u): no endpoints responded! Stopping the match", game->round);
+		game->match_stop  = true;
+		game->match_phase = MATCH_STOP;
+		return;
 	}
 
+	LT_I("Match (round %u): all clients' ping check finished", game->round);
+
+	// calculate the local timestamp based on max RTT of all endpoints
+	// add 100 ms (overhead)
+	game->count_at = millis() + max_rtt + 100;
+	// calculate the actual match start timestamp
+	// add the countdown timer
+	game->start_at = game->count_at + GAME_COUNTDOWN_SEC * 1000;
+	// send to clients
+	pkt_game_start_round_t pkt = {
+		.hdr.type = PKT_GAME_START_ROUND,
+		.count_at = game->count_at,
+		.start_at = game->start_at,
+	};
+	net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
+
+	match_count_wait(game);
+}
+
+static void match_count_wait(game_t *game) {
 	// after all endpoints are synchronized to start the match, mark players as PLAYING
 	player_t *player;
 	DL_FOREACH(game->players, player) {
@@ -174,148 +265,224 @@ static void match_run(game_t *game) {
 	}
 
 	// wait until the synchronized countdown
-	LT_I("Match (round %u): counting at %llu...", game->round, count_at);
-	unsigned long long local_time = millis();
-	if (count_at > local_time) {
-		SDL_Delay((uint32_t)(count_at - local_time));
-		if (game->match_stop)
-			return;
-	} else {
+	LT_I("Match (round %u): counting at %llu...", game->round, game->count_at);
+	if (game->count_at <= millis())
 		LT_W("Match (round %u): system clock is behind count_at time!", game->round);
+	game->start_in	  = 0;
+	game->match_phase = MATCH_COUNTING;
+	match_sleep_until(game, game->count_at);
+}
+
+static void match_counting(game_t *game) {
+	if (game->start_in == 0) {
+		// start the countdown
+		game->state	   = GAME_COUNTING;
+		game->start_in = GAME_COUNTDOWN_SEC;
+	} else {
+		game->start_in--;
 	}
 
+	// update UI state
+	match_send_ui_update(game, MATCH_UPDATE_STATE);
+
 	// run the countdown with approximate delays
-	game->state	   = GAME_COUNTING;
-	game->start_in = GAME_COUNTDOWN_SEC;
-	do {
-		// update UI state
-		match_send_sdl_event(game, MATCH_UPDATE_STATE);
-		// the last delay is unnecessary
-		if (game->start_in == 1)
-			break;
+	unsigned long long local_time = millis();
+	if (game->start_in > 1 && local_time < game->start_at) {
 		// wait for at most 1000 ms
-		local_time = millis();
-		if (local_time >= start_at)
-			break;
-		int to_start = start_at - local_time;
-		SDL_Delay(min(to_start, 1000));
-		if (game->match_stop)
-			return;
-	} while (--game->start_in);
-
-	// wait until the synchronized match start
-	LT_I("Match (round %u): starting at %llu...", game->round, start_at);
-	local_time = millis();
-	if (start_at > local_time) {
-		SDL_Delay((uint32_t)(start_at - local_time));
-		if (game->match_stop)
-			return;
-	} else {
-		LT_W("Match (round %u): system clock is behind start_at time!", game->round);
+		match_sleep_until(game, min(game->start_at, local_time + 1000));
+		return;
 	}
 
+	// the last delay is unnecessary, wait until the synchronized match start
+	LT_I("Match (round %u): starting at %llu...", game->round, game->start_at);
+	if (game->start_at <= local_time)
+		LT_W("Match (round %u): system clock is behind start_at time!", game->round);
+	game->match_phase = MATCH_START_WAIT;
+	match_sleep_until(game, game->start_at);
+}
+
+static void match_start(game_t *game) {
 	game->state = GAME_PLAYING;
-	match_send_sdl_event(game, MATCH_UPDATE_STATE);
+	match_send_ui_update(game, MATCH_UPDATE_STATE);
 
 	LT_I("Match (round %u): starting now!", game->round);
 
 	// calculate performance delays
-	uint64_t perf_freq		 = SDL_GetPerformanceFrequency();
-	uint64_t perf_cur		 = SDL_GetPerformanceCounter();
-	uint64_t perf_loop_delay = perf_freq * game->delay / 1000;
-	uint64_t perf_loop_next	 = perf_cur + perf_loop_delay;
-	uint64_t perf_ui_delay	 = perf_freq * 16 / 1000;
-	uint64_t perf_ui_next	 = perf_cur + perf_ui_delay;
+	uint64_t perf_freq		= SDL_GetPerformanceFrequency();
+	uint64_t perf_cur		= SDL_GetPerformanceCounter();
+	game->perf_loop_delay	= perf_freq * game->delay / 1000;
+	game->perf_loop_next	= perf_cur + game->perf_loop_delay;
+	game->perf_ui_delay		= perf_freq * 16 / 1000;
+	game->perf_ui_next		= perf_cur + game->perf_ui_delay;
+	game->match_any_playing = false;
+	game->round_ticks		= 0;
+	game->spectate_keyframe = true;
+	game->tick_late_max		= 0;
+	memset(game->tick_late_hist, 0, sizeof(game->tick_late_hist));
 
 	LT_D("Match (round %u): performance frequency: %llu", game->round, (unsigned long long)perf_freq);
 
-	// run the main game loop
-	bool any_playing = false;
-	do {
-		bool match_update_state = false;
-		bool any_in_round		= false;
-		bool any_spectating		= false;
+	// start recording the round
+	match_replay_start(game);
 
-		// lock the game
-		SDL_LOCK_MUTEX(game->mutex);
+	// run the first tick immediately
+	game->match_phase = MATCH_PLAYING;
+}
 
-		// check if there are any spectators
-		DL_FOREACH(game->players, player) {
-			if (player->state == PLAYER_SPECTATING) {
-				any_spectating = true;
-				break;
-			}
+/**
+ * Run a single simulation tick for all players in the round, then publish the snapshot for the UI.
+ * Shared by the match scheduler and the headless simulation (sim.c).
+ *
+ * @param state_changed set to true if any player's state changed (lap advanced, crashed, finished, etc.)
+ * @return whether any player is still playing in this round
+ */
+bool match_tick_players(game_t *game, bool *state_changed) {
+	player_t *player;
+	player_batch_t batch;
+	bool any_in_round	= false;
+	bool any_spectating = false;
+
+	// lock the game
+	SDL_LOCK_MUTEX(game->mutex);
+	// the latest position of every player in the round will belong to this tick
+	game->round_ticks++;
+
+	// check if there are any spectators
+	DL_FOREACH(game->players, player) {
+		if (player->state == PLAYER_SPECTATING) {
+			any_spectating = true;
+			break;
 		}
+	}
 
-		// process all players
-		DL_FOREACH(game->players, player) {
+	// process all players
+	player_batch_begin(&batch);
+	player = game->players;
+	while (player != NULL || batch.count != 0) {
+		// add players to the batch until it's full
+		for (; player != NULL; player = player->next) {
 			if (!player->is_in_round)
 				continue;
-			SDL_LOCK_MUTEX(player->mutex);
-			bool player_changed = false;
-			if (player_loop(player)) {
+			if (!player_batch_add(&batch, player))
+				break;
+		}
+		// calculate all players' positions at once
+		player_batch_step(&batch);
+		for (unsigned int i = 0; i < batch.count; i++) {
+			player_t *batch_player = batch.player[i];
+			if (batch.changed[i]) {
 				// player state changed (lap advanced, crashed, finished, etc.)
-				player_changed	   = true;
-				match_update_state = true;
+				*state_changed = true;
 				// save the leading player's lap number
-				game->lap = max(game->lap, player->pos[0].lap);
+				game->lap = max(game->lap, PLAYER_POS(batch_player, 0)->lap);
 			}
+			// record the finalized position in the replay
+			if (batch.shifted[i])
+				match_replay_record(game, batch_player, &batch.retired[i]);
 			// check if anyone is still playing
-			if (player->is_in_round) {
-				any_in_round = true;
-				any_playing	 = true;
+			if (batch_player->is_in_round) {
+				any_in_round			= true;
+				game->match_any_playing = true;
 			}
-			// server: send player state updates to spectators
+			// server: send player state updates to spectators' lobby
 			// (if any player changed state, or the game just started - tick 5)
-			if (game->is_server && any_spectating && (player_changed || player->time == 5)) {
-				game_request_send_update(game, false, player->id);
+			if (game->is_server && any_spectating && (batch.changed[i] || batch_player->time == 5)) {
+				game_request_send_update(game, false, batch_player->id);
 			}
-			SDL_UNLOCK_MUTEX(player->mutex);
 		}
+		player_batch_end(&batch);
+	}
+	match_replay_tick(game);
 
-		// unlock the game
-		SDL_UNLOCK_MUTEX(game->mutex);
-
-		// client: update the UI
-		perf_cur = SDL_GetPerformanceCounter();
-		if (!game->is_server && perf_cur >= perf_ui_next) {
-			if (match_update_state) {
-				match_send_sdl_event(game, MATCH_UPDATE_STATE);
-				match_update_state = false;
-			} else {
-				match_send_sdl_event(game, MATCH_UPDATE_STEP_PLAYERS);
-			}
-			perf_ui_next += perf_ui_delay;
-		}
+	// server: stream the players' positions to spectators
+	if (game->is_server && any_spectating)
+		match_spectate_tick(game);
 
-		// wait until the next loop timestamp
-		perf_cur = SDL_GetPerformanceCounter();
-		if (perf_cur < perf_loop_next) {
-			uint64_t perf_diff = perf_loop_next - perf_cur;
-			SDL_Delay((uint32_t)(perf_diff * 1000 / perf_freq));
-		} else {
-			LT_W(
-				"Match (round %u): can't keep up! %llu >= %llu",
-				game->round,
-				(unsigned long long)perf_cur,
-				(unsigned long long)perf_loop_next
-			);
-		}
-		// increment the next loop timestamp
-		perf_loop_next += perf_loop_delay;
+	// publish the tick's state for the UI
+	match_snapshot_publish(game);
 
-		if (!any_in_round)
-			break;
-	} while (!game->match_stop);
+	// unlock the game
+	SDL_UNLOCK_MUTEX(game->mutex);
+	return any_in_round;
+}
+
+static void match_tick(game_t *game) {
+	bool match_update_state = false;
+	bool any_in_round		= match_tick_players(game, &match_update_state);
+
+	// client: let the server verify the simulation
+	if (!game->is_server)
+		match_send_hashes(game);
+
+	// client: update the UI
+	uint64_t perf_cur = SDL_GetPerformanceCounter();
+	if (!game->is_server && perf_cur >= game->perf_ui_next) {
+		if (match_update_state)
+			match_send_ui_update(game, MATCH_UPDATE_STATE);
+		else
+			match_send_ui_update(game, MATCH_UPDATE_STEP_PLAYERS);
+		game->perf_ui_next += game->perf_ui_delay;
+	}
 
-	if (!any_playing) {
+	if (!any_in_round) {
+		match_round_finish(game);
+		return;
+	}
+
+	// run the next tick at the next loop timestamp
+	perf_cur = SDL_GetPerformanceCounter();
+	if (perf_cur >= game->perf_loop_next) {
+		LT_W(
+			"Match (round %u): can't keep up! %llu >= %llu",
+			game->round,
+			(unsigned long long)perf_cur,
+			(unsigned long long)game->perf_loop_next
+		);
+	}
+	game->match_deadline = game->perf_loop_next;
+	// increment the next loop timestamp
+	game->perf_loop_next += game->perf_loop_delay;
+}
+
+static void match_round_finish(game_t *game) {
+	if (!game->match_any_playing) {
 		// stop the match if no player was ever playing in this round
 		LT_I("Match (round %u): played with no players! Stopping the match...", game->round);
 		game->match_stop = true;
 	}
 
 	LT_I("Match (round %u): finished", game->round);
+
+	// save the round's replay
+	match_replay_finish(game);
+
+	// print the tick lateness histogram
+	char hist[MATCH_LATE_BUCKETS * 24];
+	char *hist_end = hist;
+	for (int i = 0; i < MATCH_LATE_BUCKETS; i++) {
+		if (i < MATCH_LATE_BUCKETS - 1)
+			hist_end += sprintf(hist_end, " <%uus: %u,", tick_late_buckets[i], game->tick_late_hist[i]);
+		else
+			hist_end += sprintf(hist_end, " more: %u", game->tick_late_hist[i]);
+	}
+	LT_I("Match (round %u): tick lateness:%s (max %u us)", game->round, hist, game->tick_late_max);
 	game->state = game->match_stop ? GAME_IDLE : GAME_FINISHED;
 	game->round++;
-	match_send_sdl_event(game, MATCH_UPDATE_STATE);
+	match_send_ui_update(game, MATCH_UPDATE_STATE);
+
+	// wait for all players to be ready for the next round
+	game->match_phase = game->match_stop ? MATCH_STOP : MATCH_READY_WAIT;
+}
+
+/**
+ * Set the match's deadline to a millis() timestamp.
+ */
+static void match_sleep_until(game_t *game, unsigned long long timestamp) {
+	unsigned long long local_time = millis();
+	uint64_t perf_cur			  = SDL_GetPerformanceCounter();
+	if (timestamp <= local_time) {
+		game->match_deadline = perf_cur;
+		return;
+	}
+	game->match_deadline = perf_cur + (timestamp - local_time) * SDL_GetPerformanceFrequency() / 1000;
 }
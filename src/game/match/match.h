@@ -5,12 +5,43 @@
 #include "include.h"
 
 typedef struct game_t game_t;
+typedef struct net_endpoint_t net_endpoint_t;
+typedef struct match_snapshot_t match_snapshot_t;
+typedef struct pkt_spectate_frame_t pkt_spectate_frame_t;
+
+// deadline of a match that is only woken up by events
+#define MATCH_DEADLINE_NONE UINT64_MAX
+// flag set in 'snapshot_latest' when a snapshot was published, but not yet acquired by the renderer
+#define MATCH_SNAPSHOT_FRESH 0x100
 
 // match.c
 bool match_init(game_t *game);
 void match_stop(game_t *game);
+bool match_step(game_t *game);
+bool match_tick_players(game_t *game, bool *state_changed);
+
+// scheduler.c
+bool match_sched_add(game_t *game);
+void match_sched_remove(game_t *game);
+void match_wake(game_t *game);
+
+// sim.c
+bool match_sim_run(const char *script_file);
+
+// spectate.c
+void match_spectate_tick(game_t *game);
+void match_spectate_keyframe(game_t *game, unsigned int tick, net_endpoint_t *endpoint);
+bool match_spectate_apply(game_t *game, pkt_spectate_frame_t *pkt);
+
+// snapshot.c
+void match_snapshot_init(game_t *game);
+void match_snapshot_free(game_t *game);
+void match_snapshot_publish(game_t *game);
+match_snapshot_t *match_snapshot_acquire(game_t *game);
 
 // utils.c
 bool match_check_ready(game_t *game);
-bool match_wait_ready(game_t *game);
-void match_send_sdl_event(game_t *game, int code);
+void match_send_ui_update(game_t *game, int code);
+void match_send_hashes(game_t *game);
+
+#include "replay.h"
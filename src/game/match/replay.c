@@ -0,0 +1,509 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-6.
+
+#include "match.h"
+
+typedef struct replay_write_t {
+	char filename[256];		 //!< Replay file name
+	uint8_t *data;			 //!< File data
+	size_t size;			 //!< File size
+	unsigned int round;		 //!< Round number (for logging)
+	unsigned int ticks;		 //!< Number of ticks (for logging)
+	unsigned int keypresses; //!< Number of keypress events (for logging)
+} replay_write_t;
+
+static SDL_atomic_t replay_writes = {0}; //!< Number of replay files being written in the background
+
+static void replay_rec_free(replay_rec_t *rec);
+static int replay_write_thread(replay_write_t *job);
+static void replay_write(replay_write_t *job);
+static bool replay_rec_keyframe(replay_rec_t *rec, unsigned int tick);
+static void replay_pos_store(replay_pos_t *out, player_pos_t *pos);
+static void replay_pos_load(player_pos_t *out, replay_pos_t *pos);
+
+/**
+ * Start recording a replay of the current round, if enabled in settings ('replay_dir').
+ * Must be called by the match thread, after the players' starting positions are set.
+ */
+void match_replay_start(game_t *game) {
+	replay_rec_free(game->replay);
+	game->replay = NULL;
+	if (SETTINGS->replay_dir == NULL)
+		return;
+
+	replay_rec_t *rec;
+	MALLOC(rec, sizeof(*rec), return);
+
+	SDL_LOCK_MUTEX(game->mutex);
+	player_t *player;
+	unsigned int count = 0;
+	DL_FOREACH(game->players, player) {
+		if (player->is_in_round)
+			count++;
+	}
+	if (count == 0)
+		goto error;
+
+	rec->header.magic			  = REPLAY_MAGIC;
+	rec->header.version			  = REPLAY_VERSION;
+	rec->header.start_at		  = game->start_at;
+	rec->header.speed			  = game->speed;
+	rec->header.round			  = game->round;
+	rec->header.player_count	  = count;
+	rec->header.keyframe_interval = REPLAY_KEYFRAME_TICKS;
+	rec->keyframe_len			  = sizeof(*rec->keyframes) + sizeof(replay_pos_t) * count;
+	strcpy(rec->header.key, game->key);
+	MALLOC(rec->players, sizeof(*rec->players) * count, goto error);
+	MALLOC(rec->handles, sizeof(*rec->handles) * count, goto error);
+	MALLOC(rec->last, sizeof(*rec->last) * count, goto error);
+
+	unsigned int i = 0;
+	DL_FOREACH(game->players, player) {
+		if (!player->is_in_round)
+			continue;
+		SDL_WITH_MUTEX(player->mutex) {
+			rec->handles[i]		  = player;
+			rec->players[i].id	  = player->id;
+			rec->players[i].color = player->color;
+			strcpy(rec->players[i].name, player->name);
+			replay_pos_store(&rec->players[i].start, PLAYER_POS(player, 0));
+			rec->last[i] = rec->players[i].start;
+		}
+		i++;
+	}
+
+	// save the starting positions as the first keyframe
+	if (!replay_rec_keyframe(rec, 0))
+		goto error;
+	game->replay = rec;
+	SDL_UNLOCK_MUTEX(game->mutex);
+	return;
+
+error:
+	SDL_UNLOCK_MUTEX(game->mutex);
+	replay_rec_free(rec);
+}
+
+/**
+ * Record a player's position that has left the rollback window (it can't change anymore).
+ * Direction changes are saved as keypress events.
+ * Must be called with the player locked.
+ */
+void match_replay_record(game_t *game, player_t *player, player_pos_t *pos) {
+	replay_rec_t *rec = game->replay;
+	if (rec == NULL)
+		return;
+	unsigned int i;
+	for (i = 0; i < rec->header.player_count; i++) {
+		if (rec->handles[i] == player)
+			break;
+	}
+	// skip unknown players, and positions that were already recorded (or didn't move)
+	if (i >= rec->header.player_count || pos->time <= rec->last[i].time)
+		return;
+
+	if (pos->direction != rec->last[i].direction) {
+		if (rec->header.keypress_count == rec->keypresses_size) {
+			unsigned int size			  = rec->keypresses_size ? rec->keypresses_size * 2 : 64;
+			replay_keypress_t *keypresses = realloc(rec->keypresses, sizeof(*keypresses) * size);
+			if (keypresses == NULL)
+				LT_ERR(E, return, "Memory allocation failed for the replay (%u keypresses)", size);
+			rec->keypresses		 = keypresses;
+			rec->keypresses_size = size;
+		}
+		replay_keypress_t *keypress = &rec->keypresses[rec->header.keypress_count++];
+		keypress->time				= pos->time;
+		keypress->player			= i;
+		keypress->direction			= pos->direction;
+	}
+	replay_pos_store(&rec->last[i], pos);
+}
+
+/**
+ * Finish recording a tick - save a keyframe if needed.
+ * Must be called after match_replay_record() was called for all players.
+ */
+void match_replay_tick(game_t *game) {
+	replay_rec_t *rec = game->replay;
+	if (rec == NULL)
+		return;
+	unsigned int time = 0;
+	for (unsigned int i = 0; i < rec->header.player_count; i++) {
+		time = max(time, rec->last[i].time);
+	}
+	unsigned int tick = time / 5;
+	if (tick <= rec->header.tick_count)
+		return;
+	rec->header.tick_count = tick;
+	if (tick % REPLAY_KEYFRAME_TICKS == 0)
+		replay_rec_keyframe(rec, tick);
+}
+
+/**
+ * Finish recording the round - record the positions remaining in the rollback window and write the replay file.
+ * The file is written in a separate thread, so that the match's worker (shared with other matches) doesn't wait
+ * for the disk. Must be called by the match thread.
+ */
+void match_replay_finish(game_t *game) {
+	replay_rec_t *rec = game->replay;
+	if (rec == NULL)
+		return;
+
+	SDL_WITH_MUTEX(game->mutex) {
+		// find the latest position of any player
+		unsigned int time_max = 0;
+		for (unsigned int i = 0; i < rec->header.player_count; i++) {
+			SDL_WITH_MUTEX(rec->handles[i]->mutex) {
+				time_max = max(time_max, PLAYER_POS(rec->handles[i], 0)->time);
+			}
+		}
+		// record the remaining positions tick by tick, so that keyframes are saved too
+		for (unsigned int time = rec->header.tick_count * 5 + 5; time <= time_max; time += 5) {
+			for (unsigned int i = 0; i < rec->header.player_count; i++) {
+				player_t *player = rec->handles[i];
+				SDL_WITH_MUTEX(player->mutex) {
+					for (unsigned int index = player->pos_num; index-- > 0;) {
+						if (PLAYER_POS(player, index)->time != time)
+							continue;
+						match_replay_record(game, player, PLAYER_POS(player, index));
+						break;
+					}
+				}
+			}
+			match_replay_tick(game);
+		}
+		game->replay = NULL;
+
+		// save the players' final state
+		for (unsigned int i = 0; i < rec->header.player_count; i++) {
+			rec->players[i].end_state = rec->handles[i]->state;
+			rec->players[i].end_time  = rec->last[i].time;
+		}
+	}
+
+	// mark the players' positions as moving or not (known only at the end of the round)
+	for (unsigned int i = 0; i < rec->header.player_count; i++) {
+		replay_player_t *player = &rec->players[i];
+		bool is_playing			= player->end_state == PLAYER_PLAYING;
+		player->start.active	= is_playing || player->start.time < player->end_time;
+		for (unsigned int k = 0; k < rec->header.keyframe_count; k++) {
+			replay_keyframe_t *keyframe = (void *)((uint8_t *)rec->keyframes + rec->keyframe_len * k);
+			keyframe->pos[i].active		= is_playing || keyframe->pos[i].time < player->end_time;
+		}
+	}
+
+	// build the file in memory
+	replay_header_t *header = &rec->header;
+	size_t players_len		= sizeof(*rec->players) * header->player_count;
+	size_t keypresses_len	= sizeof(*rec->keypresses) * header->keypress_count;
+	size_t keyframes_len	= rec->keyframe_len * header->keyframe_count;
+	size_t size				= sizeof(*header) + players_len + keypresses_len + keyframes_len;
+	replay_write_t *job;
+	MALLOC(job, sizeof(*job), goto cleanup);
+	MALLOC(job->data, size, free(job); goto cleanup);
+	job->size		= size;
+	job->round		= header->round;
+	job->ticks		= header->tick_count;
+	job->keypresses = header->keypress_count;
+	uint8_t *ptr	= job->data;
+	memcpy(ptr, header, sizeof(*header));
+	ptr += sizeof(*header);
+	memcpy(ptr, rec->players, players_len);
+	ptr += players_len;
+	if (keypresses_len != 0)
+		memcpy(ptr, rec->keypresses, keypresses_len);
+	ptr += keypresses_len;
+	memcpy(ptr, rec->keyframes, keyframes_len);
+
+	snprintf(
+		job->filename,
+		sizeof(job->filename),
+		"%s/%s-%llu-%02u.replay",
+		SETTINGS->replay_dir,
+		header->key,
+		(unsigned long long)header->start_at,
+		header->round
+	);
+
+	SDL_AtomicAdd(&replay_writes, 1);
+	SDL_Thread *thread = SDL_CreateThread((SDL_ThreadFunction)replay_write_thread, "replay", job);
+	if (thread != NULL) {
+		SDL_DetachThread(thread);
+	} else {
+		LT_W("Match (round %u): can't start the replay writer thread, writing here", job->round);
+		replay_write(job);
+	}
+
+cleanup:
+	replay_rec_free(rec);
+}
+
+/**
+ * Wait until all replay files are written, e.g. before exiting.
+ */
+void match_replay_wait() {
+	while (SDL_AtomicGet(&replay_writes) != 0) {
+		SDL_Delay(10);
+	}
+}
+
+static int replay_write_thread(replay_write_t *job) {
+	lt_log_set_thread_name("replay");
+	replay_write(job);
+	return 0;
+}
+
+static void replay_write(replay_write_t *job) {
+	if (file_write_data(job->filename, (const char *)job->data, job->size))
+		LT_I(
+			"Match (round %u): replay saved to '%s' (%u ticks, %u keypresses, %llu bytes)",
+			job->round,
+			job->filename,
+			job->ticks,
+			job->keypresses,
+			(unsigned long long)job->size
+		);
+	free(job->data);
+	free(job);
+	SDL_AtomicAdd(&replay_writes, -1);
+}
+
+/**
+ * Open a replay file. The file is memory-mapped where possible (read into memory otherwise).
+ *
+ * @return replay handle, or NULL if the file can't be read or is not a valid replay
+ */
+replay_t *match_replay_open(const char *filename) {
+	replay_t *replay;
+	MALLOC(replay, sizeof(*replay), return NULL);
+
+#if !WIN32
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		LT_ERR(E, goto error, "Can't open file '%s'", filename);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		LT_ERR(E, goto error, "Can't read file '%s'", filename);
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		LT_ERR(E, goto error, "Can't map file '%s'", filename);
+	replay->data	  = data;
+	replay->size	  = st.st_size;
+	replay->is_mapped = true;
+#else
+	FILE *file;
+	FOPEN(file, filename, "rb", goto error);
+	int length = 0;
+	FSEEK(file, 0, SEEK_END, goto error_file);
+	FTELL(file, length, goto error_file);
+	FSEEK(file, 0, SEEK_SET, goto error_file);
+	MALLOC(replay->data, length, goto error_file);
+	FREAD(file, replay->data, length, goto error_file);
+	fclose(file);
+	replay->size = length;
+#endif
+
+	// validate the header and all section sizes
+	replay_header_t *header = (void *)replay->data;
+	if (replay->size < sizeof(*header) || header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION)
+		LT_ERR(E, goto error, "File '%s' is not a valid replay", filename);
+	if (header->player_count > GAME_PLAYERS_MAX || header->keyframe_interval == 0)
+		LT_ERR(E, goto error, "Replay file '%s' has an invalid header", filename);
+	replay->keyframe_len = sizeof(replay_keyframe_t) + sizeof(replay_pos_t) * header->player_count;
+	size_t size			 = sizeof(*header) + sizeof(replay_player_t) * header->player_count +
+				  sizeof(replay_keypress_t) * header->keypress_count + replay->keyframe_len * header->keyframe_count;
+	if (replay->size < size || header->keyframe_count == 0)
+		LT_ERR(E, goto error, "Replay file '%s' is truncated", filename);
+
+	replay->header	   = header;
+	replay->players	   = (void *)(replay->data + sizeof(*header));
+	replay->keypresses = (void *)(replay->players + header->player_count);
+	replay->keyframes  = (void *)(replay->keypresses + header->keypress_count);
+
+	// the angles index the sin/cos tables when re-simulating
+	for (unsigned int i = 0; i < header->keyframe_count; i++) {
+		replay_keyframe_t *keyframe = (void *)(replay->keyframes + replay->keyframe_len * i);
+		for (unsigned int j = 0; j < header->player_count; j++) {
+			if (keyframe->pos[j].angle >= 360)
+				LT_ERR(E, goto error, "Replay file '%s' has an invalid angle in keyframe %u", filename, i);
+		}
+	}
+	return replay;
+
+#if WIN32
+error_file:
+	fclose(file);
+#endif
+error:
+	match_replay_close(replay);
+	return NULL;
+}
+
+void match_replay_close(replay_t *replay) {
+	if (replay == NULL)
+		return;
+#if !WIN32
+	if (replay->is_mapped)
+		munmap(replay->data, replay->size);
+	else
+		free(replay->data);
+#else
+	free(replay->data);
+#endif
+	free(replay);
+}
+
+/**
+ * Calculate the players' positions at the specified tick.
+ * The nearest preceding keyframe is found directly, and the remaining ticks are re-simulated.
+ *
+ * @param pos output array of 'player_count' positions
+ * @return false if the tick is out of range
+ */
+bool match_replay_seek(replay_t *replay, unsigned int tick, replay_pos_t *pos) {
+	replay_header_t *header = replay->header;
+	if (tick > header->tick_count)
+		return false;
+
+	unsigned int index			= min(tick / header->keyframe_interval, header->keyframe_count - 1);
+	replay_keyframe_t *keyframe = (void *)(replay->keyframes + replay->keyframe_len * index);
+	unsigned int time			= tick * 5;
+
+	for (unsigned int i = 0; i < header->player_count; i++) {
+		pos[i] = keyframe->pos[i];
+		if (!pos[i].active)
+			continue;
+
+		// re-simulate the player from the keyframe, using the same code as the match
+		player_pos_t sim_pos[2] = {0};
+		player_t sim			= {
+			.id		 = replay->players[i].id,
+			.state	 = PLAYER_PLAYING,
+			.pos	 = sim_pos,
+			.pos_num = 2,
+		};
+		replay_pos_load(PLAYER_POS(&sim, 0), &pos[i]);
+		unsigned int keypress = keyframe->keypress_index;
+		while (PLAYER_POS(&sim, 0)->time < time && sim.state == PLAYER_PLAYING) {
+			// move the head, keeping the current position as the previous one
+			sim.pos_head	   = (sim.pos_head + 1) % sim.pos_num;
+			player_pos_t *prev = PLAYER_POS(&sim, 1);
+			// apply the direction changes at this position
+			for (; keypress < header->keypress_count; keypress++) {
+				replay_keypress_t *event = &replay->keypresses[keypress];
+				if (event->time > prev->time)
+					break;
+				if (event->player == i)
+					prev->direction = event->direction;
+			}
+			player_position_calculate(&sim, 1);
+		}
+		replay_pos_store(&pos[i], PLAYER_POS(&sim, 0));
+		pos[i].active = sim.state == PLAYER_PLAYING;
+	}
+	return true;
+}
+
+/**
+ * Print the replay's summary and the players' positions at the specified tick (or the last tick, if negative).
+ */
+bool match_replay_dump(const char *filename, int tick) {
+	replay_t *replay = match_replay_open(filename);
+	if (replay == NULL)
+		return false;
+	replay_header_t *header = replay->header;
+	LT_I(
+		"Replay: game %s, round %u, speed %u, %u player(s), %u ticks, %u keypresses, %u keyframes",
+		header->key,
+		header->round,
+		header->speed,
+		header->player_count,
+		header->tick_count,
+		header->keypress_count,
+		header->keyframe_count
+	);
+
+	bool ret		  = false;
+	replay_pos_t *pos = NULL;
+	MALLOC(pos, sizeof(*pos) * max(header->player_count, 1), goto cleanup);
+	if (tick < 0 || tick > header->tick_count)
+		tick = (int)header->tick_count;
+	if (!match_replay_seek(replay, tick, pos))
+		goto cleanup;
+	for (unsigned int i = 0; i < header->player_count; i++) {
+		replay_player_t *player = &replay->players[i];
+		LT_I(
+			" - #%u '%s' @ %u: x=%.3f, y=%.3f, angle=%u, speed=%.3f, lap %u%s",
+			player->id,
+			player->name,
+			pos[i].time,
+			pos[i].x,
+			pos[i].y,
+			pos[i].angle,
+			pos[i].speed,
+			pos[i].lap,
+			pos[i].active ? "" : " (stopped)"
+		);
+	}
+	ret = true;
+
+cleanup:
+	free(pos);
+	match_replay_close(replay);
+	return ret;
+}
+
+static void replay_rec_free(replay_rec_t *rec) {
+	if (rec == NULL)
+		return;
+	free(rec->players);
+	free(rec->handles);
+	free(rec->last);
+	free(rec->keypresses);
+	free(rec->keyframes);
+	free(rec);
+}
+
+static bool replay_rec_keyframe(replay_rec_t *rec, unsigned int tick) {
+	if (rec->header.keyframe_count == rec->keyframes_size) {
+		unsigned int size			 = rec->keyframes_size ? rec->keyframes_size * 2 : 16;
+		replay_keyframe_t *keyframes = realloc(rec->keyframes, rec->keyframe_len * size);
+		if (keyframes == NULL)
+			LT_ERR(E, return false, "Memory allocation failed for the replay (%u keyframes)", size);
+		rec->keyframes		= keyframes;
+		rec->keyframes_size = size;
+	}
+	replay_keyframe_t *keyframe =
+		(void *)((uint8_t *)rec->keyframes + rec->keyframe_len * rec->header.keyframe_count++);
+	keyframe->tick			 = tick;
+	keyframe->keypress_index = rec->header.keypress_count;
+	memcpy(keyframe->pos, rec->last, sizeof(*rec->last) * rec->header.player_count);
+	return true;
+}
+
+static void replay_pos_store(replay_pos_t *out, player_pos_t *pos) {
+	out->time			 = pos->time;
+	out->angle			 = pos->angle;
+	out->speed			 = pos->speed;
+	out->x				 = pos->x;
+	out->y				 = pos->y;
+	out->lap			 = pos->lap;
+	out->direction		 = pos->direction;
+	out->lap_can_advance = pos->lap_can_advance;
+	out->active			 = true;
+}
+
+static void replay_pos_load(player_pos_t *out, replay_pos_t *pos) {
+	out->time			 = pos->time;
+	out->angle			 = pos->angle;
+	out->speed			 = pos->speed;
+	out->x				 = pos->x;
+	out->y				 = pos->y;
+	out->lap			 = pos->lap;
+	out->direction		 = pos->direction;
+	out->direction_set	 = false;
+	out->confirmed		 = true;
+	out->lap_can_advance = pos->lap_can_advance;
+}
@@ -0,0 +1,104 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-6.
+
+#pragma once
+
+#include "include.h"
+
+#include "game/player/player_t.h"
+
+#define REPLAY_MAGIC   0x4C50525A // "ZRPL"
+#define REPLAY_VERSION 1
+
+/*
+ * Replay file layout (one round per file):
+ * - replay_header_t
+ * - replay_player_t[player_count]
+ * - replay_keypress_t[keypress_count] (sorted by time)
+ * - keyframes[keyframe_count] - replay_keyframe_t, followed by replay_pos_t[player_count]
+ *   (keyframe N describes tick N * keyframe_interval)
+ */
+
+typedef PACK(struct replay_pos_t {
+	uint32_t time;			 //!< Position timestamp (ticks)
+	uint32_t angle;			 //!< Turning angle, 0..359
+	double speed;			 //!< Moving speed
+	double x;				 //!< Position X
+	double y;				 //!< Position Y
+	uint32_t lap;			 //!< Lap number, 1..4
+	uint8_t direction;		 //!< Movement direction for the next position
+	uint8_t lap_can_advance; //!< Whether the player moved through half a lap
+	uint8_t active;			 //!< Whether the player is still moving after this position
+	uint8_t reserved;
+}) replay_pos_t;
+
+typedef PACK(struct replay_header_t {
+	uint32_t magic;	  //!< REPLAY_MAGIC
+	uint32_t version; //!< REPLAY_VERSION
+	char key[GAME_KEY_LEN + 1];
+	STRUCT_PADDING(key, GAME_KEY_LEN + 1);
+	uint64_t start_at;			//!< Round start timestamp
+	uint32_t speed;				//!< Game speed, 1..9
+	uint32_t round;				//!< Round number
+	uint32_t player_count;		//!< Number of players in the round
+	uint32_t tick_count;		//!< Number of recorded ticks
+	uint32_t keypress_count;	//!< Number of keypress events
+	uint32_t keyframe_interval; //!< Ticks between keyframes
+	uint32_t keyframe_count;	//!< Number of keyframes
+	uint32_t reserved;
+}) replay_header_t;
+
+typedef PACK(struct replay_player_t {
+	uint32_t id;	//!< Player ID
+	uint32_t color; //!< Player's line color
+	char name[PLAYER_NAME_LEN + 1];
+	STRUCT_PADDING(name, PLAYER_NAME_LEN + 1);
+	player_state_t end_state : 32; //!< Player state at the end of the round
+	uint32_t end_time;			   //!< Timestamp of the last position (crash/finish)
+	replay_pos_t start;			   //!< Starting position
+}) replay_player_t;
+
+typedef PACK(struct replay_keypress_t {
+	uint32_t time;		//!< Timestamp of the position where the direction changes
+	uint16_t player;	//!< Player index
+	uint16_t direction; //!< New movement direction
+}) replay_keypress_t;
+
+typedef PACK(struct replay_keyframe_t {
+	uint32_t tick;			 //!< Tick number
+	uint32_t keypress_index; //!< Number of keypress events up to this tick (incl.)
+	replay_pos_t pos[];		 //!< Positions of all players
+}) replay_keyframe_t;
+
+typedef struct replay_rec_t {
+	replay_header_t header;		   //!< File header (updated while recording)
+	replay_player_t *players;	   //!< Recorded players
+	player_t **handles;			   //!< Recorded players' handles
+	replay_pos_t *last;			   //!< Last finalized position of every player
+	replay_keypress_t *keypresses; //!< Recorded keypress events
+	unsigned int keypresses_size;  //!< Allocated keypress capacity
+	replay_keyframe_t *keyframes;  //!< Recorded keyframes
+	unsigned int keyframes_size;   //!< Allocated keyframe capacity
+	size_t keyframe_len;		   //!< Size of a single keyframe (incl. positions)
+} replay_rec_t;
+
+typedef struct replay_t {
+	uint8_t *data;				   //!< File data (mapped or read)
+	size_t size;				   //!< File size
+	bool is_mapped;				   //!< Whether the data is memory-mapped
+	replay_header_t *header;	   //!< File header
+	replay_player_t *players;	   //!< Recorded players
+	replay_keypress_t *keypresses; //!< Recorded keypress events
+	uint8_t *keyframes;			   //!< Keyframe data
+	size_t keyframe_len;		   //!< Size of a single keyframe (incl. positions)
+} replay_t;
+
+// replay.c
+void match_replay_start(game_t *game);
+void match_replay_record(game_t *game, player_t *player, player_pos_t *pos);
+void match_replay_tick(game_t *game);
+void match_replay_finish(game_t *game);
+void match_replay_wait();
+replay_t *match_replay_open(const char *filename);
+void match_replay_close(replay_t *replay);
+bool match_replay_seek(replay_t *replay, unsigned int tick, replay_pos_t *pos);
+bool match_replay_dump(const char *filename, int tick);
@@ -0,0 +1,358 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-3.
+
+#include "match.h"
+
+static int match_sched_thread(void *param);
+
+typedef struct sched_deque_t {
+	SDL_mutex *mutex;				  //!< Mutex locking the deque
+	game_t *games[MATCH_SCHED_BATCH]; //!< Ring buffer of matches due to be stepped
+	unsigned int head;				  //!< Index of the oldest match (stolen first)
+	unsigned int count;				  //!< Number of matches in the deque
+} sched_deque_t;
+
+static SDL_mutex *sched_mutex		 = NULL; //!< Mutex locking the scheduler
+static SDL_cond *sched_cond			 = NULL; //!< Condition for waking up the workers
+static SDL_cond *sched_done_cond	 = NULL; //!< Condition for signalling matches leaving the scheduler
+static game_t **sched_heap			 = NULL; //!< Min-heap of scheduled matches, ordered by deadline
+static unsigned int sched_heap_len	 = 0;	 //!< Number of matches in the heap
+static unsigned int sched_heap_size	 = 0;	 //!< Allocated heap capacity
+static unsigned int sched_matches	 = 0;	 //!< Number of matches in the scheduler (queued or running)
+static unsigned int sched_workers	 = 0;	 //!< Number of started worker threads
+static sched_deque_t *sched_deques	 = NULL; //!< Per-worker deques of due matches
+static unsigned int sched_deques_num = 0;	 //!< Number of allocated deques (maximum number of workers)
+static SDL_atomic_t sched_queued;			 //!< Number of matches in all deques
+
+// deadline that a worker is waiting for; other idle workers wait for events only
+static uint64_t sched_timer_deadline = MATCH_DEADLINE_NONE;
+
+static void sched_heap_swap(unsigned int i, unsigned int j) {
+	game_t *game				  = sched_heap[i];
+	sched_heap[i]				  = sched_heap[j];
+	sched_heap[j]				  = game;
+	sched_heap[i]->match_heap_idx = i;
+	sched_heap[j]->match_heap_idx = j;
+}
+
+static void sched_heap_up(unsigned int i) {
+	while (i > 0) {
+		unsigned int parent = (i - 1) / 2;
+		if (sched_heap[parent]->match_deadline <= sched_heap[i]->match_deadline)
+			break;
+		sched_heap_swap(i, parent);
+		i = parent;
+	}
+}
+
+static void sched_heap_down(unsigned int i) {
+	while (true) {
+		unsigned int min   = i;
+		unsigned int left  = 2 * i + 1;
+		unsigned int right = 2 * i + 2;
+		if (left < sched_heap_len && sched_heap[left]->match_deadline < sched_heap[min]->match_deadline)
+			min = left;
+		if (right < sched_heap_len && sched_heap[right]->match_deadline < sched_heap[min]->match_deadline)
+			min = right;
+		if (min == i)
+			break;
+		sched_heap_swap(i, min);
+		i = min;
+	}
+}
+
+static bool sched_heap_push(game_t *game) {
+	if (sched_heap_len == sched_heap_size) {
+		unsigned int size = sched_heap_size ? sched_heap_size * 2 : 16;
+		game_t **heap	  = realloc(sched_heap, sizeof(*sched_heap) * size);
+		if (heap == NULL)
+			LT_ERR(E, return false, "Memory allocation failed for the match scheduler (%u matches)", size);
+		sched_heap		= heap;
+		sched_heap_size = size;
+	}
+	game->match_heap_idx		 = sched_heap_len;
+	sched_heap[sched_heap_len++] = game;
+	sched_heap_up(game->match_heap_idx);
+	return true;
+}
+
+static void sched_heap_remove(game_t *game) {
+	unsigned int i = game->match_heap_idx;
+	if (i >= sched_heap_len || sched_heap[i] != game)
+		return;
+	sched_heap_swap(i, --sched_heap_len);
+	if (i < sched_heap_len) {
+		sched_heap_up(i);
+		sched_heap_down(i);
+	}
+}
+
+static void sched_deque_push(sched_deque_t *deque, game_t *game) {
+	SDL_LOCK_MUTEX(deque->mutex);
+	deque->games[(deque->head + deque->count++) % MATCH_SCHED_BATCH] = game;
+	SDL_UNLOCK_MUTEX(deque->mutex);
+}
+
+/**
+ * Take a match out of the deque - the newest one by the deque's owner, the oldest one when stealing.
+ */
+static game_t *sched_deque_pop(sched_deque_t *deque, bool steal) {
+	game_t *game = NULL;
+	SDL_LOCK_MUTEX(deque->mutex);
+	if (deque->count != 0) {
+		if (steal) {
+			game		= deque->games[deque->head];
+			deque->head = (deque->head + 1) % MATCH_SCHED_BATCH;
+		} else {
+			game = deque->games[(deque->head + deque->count - 1) % MATCH_SCHED_BATCH];
+		}
+		deque->count--;
+		SDL_AtomicAdd(&sched_queued, -1);
+	}
+	SDL_UNLOCK_MUTEX(deque->mutex);
+	return game;
+}
+
+/**
+ * Add the match to the scheduler, starting at MATCH_INIT. Its first step will run as soon as possible.
+ * Worker threads are started on demand, up to 'match_workers' from settings
+ * (or the number of CPU cores, if 0).
+ *
+ * @return false if the match couldn't be scheduled
+ */
+bool match_sched_add(game_t *game) {
+	SDL_LOCK_MUTEX(sched_mutex);
+	if (sched_cond == NULL)
+		sched_cond = SDL_CreateCond();
+	if (sched_done_cond == NULL)
+		sched_done_cond = SDL_CreateCond();
+	if (sched_cond == NULL || sched_done_cond == NULL)
+		SDL_ERROR("SDL_CreateCond()", goto error);
+	if (game->match_scheduled)
+		LT_ERR(E, goto error, "Match: already scheduled");
+
+	game->match_stop	 = false;
+	game->match_phase	 = MATCH_INIT;
+	game->match_deadline = SDL_GetPerformanceCounter();
+	game->match_running	 = false;
+	game->match_woken	 = false;
+	if (!sched_heap_push(game))
+		goto error;
+
+	if (sched_deques == NULL) {
+		// the number of workers is fixed by the first match
+		unsigned int workers_max = SETTINGS->match_workers > 0 ? SETTINGS->match_workers : SDL_GetCPUCount();
+		sched_deques			 = calloc(max(workers_max, 1), sizeof(*sched_deques));
+		if (sched_deques == NULL) {
+			sched_heap_remove(game);
+			LT_ERR(E, goto error, "Memory allocation failed for the match scheduler (%u workers)", workers_max);
+		}
+		sched_deques_num = max(workers_max, 1);
+		// create the mutexes upfront, as the deques are shared by the workers
+		for (unsigned int i = 0; i < sched_deques_num; i++) {
+			sched_deques[i].mutex = SDL_CreateMutex();
+		}
+	}
+
+	// start another worker if all are (potentially) busy
+	if (sched_workers <= sched_matches && sched_workers < sched_deques_num) {
+		SDL_Thread *thread = SDL_CreateThread(match_sched_thread, "match", (void *)(uintptr_t)sched_workers);
+		if (thread == NULL && sched_workers == 0) {
+			// no workers to run the match at all
+			sched_heap_remove(game);
+			SDL_ERROR("SDL_CreateThread()", goto error);
+		}
+		if (thread != NULL) {
+			SDL_DetachThread(thread);
+			sched_workers++;
+		}
+	}
+
+	game->match_scheduled = true;
+	sched_matches++;
+	SDL_CondBroadcast(sched_cond);
+	SDL_UNLOCK_MUTEX(sched_mutex);
+	return true;
+
+error:
+	SDL_UNLOCK_MUTEX(sched_mutex);
+	return false;
+}
+
+/**
+ * Stop the match and wait until it leaves the scheduler.
+ * Must not be called from within match_step() of the same match.
+ */
+void match_sched_remove(game_t *game) {
+	SDL_LOCK_MUTEX(sched_mutex);
+	if (game->match_scheduled) {
+		game->match_stop = true;
+		// run the match's last step immediately
+		if (game->match_running) {
+			game->match_woken = true;
+		} else {
+			game->match_deadline = 0;
+			sched_heap_up(game->match_heap_idx);
+		}
+		SDL_CondBroadcast(sched_cond);
+		while (game->match_scheduled) {
+			SDL_CondWait(sched_done_cond, sched_mutex);
+		}
+	}
+	SDL_UNLOCK_MUTEX(sched_mutex);
+}
+
+/**
+ * Check if the match's current phase is waiting for an event (see match_wake()).
+ * Other phases run at their deadlines, so that the ticks aren't shifted by unrelated packets.
+ */
+static bool sched_is_waiting(game_t *game) {
+	switch (game->match_phase) {
+		case MATCH_PING_WAIT:
+		case MATCH_START_AT_WAIT:
+		case MATCH_READY_WAIT:
+			return true;
+		default:
+			return game->match_stop;
+	}
+}
+
+/**
+ * Wake up the match, so that its next step runs immediately.
+ * Used for events that the match is waiting for (ready state, ping, 'start_at').
+ * Does nothing if the match isn't waiting for any events.
+ */
+void match_wake(game_t *game) {
+	SDL_LOCK_MUTEX(sched_mutex);
+	if (game->match_scheduled && game->match_running) {
+		// run again as soon as the current step finishes (if it's waiting then)
+		game->match_woken = true;
+	} else if (game->match_scheduled && sched_is_waiting(game)) {
+		game->match_deadline = SDL_GetPerformanceCounter();
+		sched_heap_up(game->match_heap_idx);
+		SDL_CondBroadcast(sched_cond);
+	}
+	SDL_UNLOCK_MUTEX(sched_mutex);
+}
+
+/**
+ * Run the match's step and put it back into the heap (or out of the scheduler, if it finished).
+ */
+static void sched_run(game_t *game) {
+	bool running = match_step(game);
+
+	SDL_LOCK_MUTEX(sched_mutex);
+	game->match_running = false;
+	if (!running) {
+		game->match_scheduled = false;
+		sched_matches--;
+		SDL_CondBroadcast(sched_done_cond);
+		SDL_UNLOCK_MUTEX(sched_mutex);
+		return;
+	}
+	if (game->match_woken && sched_is_waiting(game))
+		game->match_deadline = SDL_GetPerformanceCounter();
+	if (!sched_heap_push(game)) {
+		// can't happen - the match was removed from the heap before
+		game->match_scheduled = false;
+		sched_matches--;
+		SDL_CondBroadcast(sched_done_cond);
+	} else if (game->match_deadline < sched_timer_deadline && sched_heap[0] == game) {
+		// the match is due before the deadline that the timer worker is waiting for
+		SDL_CondSignal(sched_cond);
+	}
+	SDL_UNLOCK_MUTEX(sched_mutex);
+}
+
+/**
+ * Worker thread of the scheduler.
+ *
+ * Only one idle worker waits for the earliest deadline; when it's reached, the worker takes all matches
+ * that are due at that moment out of the heap at once, queues them in its own deque, and wakes up as many
+ * idle workers as needed to steal from it. Workers run their own deque first (newest matches), then steal
+ * from the other workers (oldest matches), so that a tick of many matches costs one timer wakeup
+ * and a single pass over the heap. The results of every step are sent to the game's thread, as before.
+ */
+static int match_sched_thread(void *param) {
+	unsigned int worker = (unsigned int)(uintptr_t)param;
+	char thread_name[20];
+	snprintf(thread_name, sizeof(thread_name), "match-%u", worker);
+	lt_log_set_thread_name(thread_name);
+	srand((unsigned int)time(NULL));
+
+	uint64_t perf_freq	  = SDL_GetPerformanceFrequency();
+	uint64_t perf_precise = perf_freq * 2 / 1000;
+
+	while (true) {
+		// run the matches queued by this worker, then help the other workers
+		game_t *game = sched_deque_pop(&sched_deques[worker], false);
+		for (unsigned int i = 1; game == NULL && i < sched_deques_num; i++) {
+			game = sched_deque_pop(&sched_deques[(worker + i) % sched_deques_num], true);
+		}
+		if (game != NULL) {
+			sched_run(game);
+			continue;
+		}
+
+		SDL_LOCK_MUTEX(sched_mutex);
+		if (SDL_AtomicGet(&sched_queued) != 0) {
+			// another worker queued a batch in the meantime
+			SDL_UNLOCK_MUTEX(sched_mutex);
+			continue;
+		}
+		if (sched_heap_len == 0 || sched_heap[0]->match_deadline == MATCH_DEADLINE_NONE) {
+			// nothing to do, wait for a new match or an event
+			SDL_CondWait(sched_cond, sched_mutex);
+			SDL_UNLOCK_MUTEX(sched_mutex);
+			continue;
+		}
+
+		game			  = sched_heap[0];
+		uint64_t perf_cur = SDL_GetPerformanceCounter();
+		if (game->match_deadline > perf_cur) {
+			uint64_t deadline = game->match_deadline;
+			if (deadline >= sched_timer_deadline) {
+				// another worker is waiting for this deadline already, wait for a batch or an event
+				SDL_CondWait(sched_cond, sched_mutex);
+				SDL_UNLOCK_MUTEX(sched_mutex);
+				continue;
+			}
+			sched_timer_deadline = deadline;
+			uint64_t perf_diff	 = deadline - perf_cur;
+			if (!SETTINGS->timing_precise) {
+				// wait until the earliest deadline (rounded up), or until woken up
+				uint32_t timeout = (uint32_t)((perf_diff * 1000 + perf_freq - 1) / perf_freq);
+				SDL_CondWaitTimeout(sched_cond, sched_mutex, timeout);
+			} else if (perf_diff >= perf_precise + perf_freq / 1000) {
+				// wait until shortly before the earliest deadline, or until woken up
+				SDL_CondWaitTimeout(sched_cond, sched_mutex, (uint32_t)((perf_diff - perf_precise) * 1000 / perf_freq));
+			} else {
+				// sleep precisely until the deadline (not woken up by events - but that's at most a few ms)
+				SDL_UNLOCK_MUTEX(sched_mutex);
+				perf_sleep_until(deadline, SETTINGS->timing_spin_us);
+				SDL_LOCK_MUTEX(sched_mutex);
+			}
+			if (sched_timer_deadline == deadline)
+				sched_timer_deadline = MATCH_DEADLINE_NONE;
+			SDL_UNLOCK_MUTEX(sched_mutex);
+			continue;
+		}
+
+		// take all due matches out of the heap as one batch
+		unsigned int count = 0;
+		while (count < MATCH_SCHED_BATCH && sched_heap_len != 0 && sched_heap[0]->match_deadline <= perf_cur) {
+			game = sched_heap[0];
+			sched_heap_remove(game);
+			game->match_running = true;
+			game->match_woken	= false;
+			sched_deque_push(&sched_deques[worker], game);
+			count++;
+		}
+		SDL_AtomicAdd(&sched_queued, (int)count);
+		// wake up idle workers to steal from the batch
+		for (unsigned int i = 1; i < count && i < sched_workers; i++) {
+			SDL_CondSignal(sched_cond);
+		}
+		SDL_UNLOCK_MUTEX(sched_mutex);
+	}
+	return 0;
+}
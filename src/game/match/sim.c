@@ -0,0 +1,289 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-5.
+
+#include "match.h"
+
+typedef struct match_sim_result_t {
+	player_state_t state; //!< Player state at the end of the round
+	unsigned int time;	  //!< Timestamp of the crash/finish event (ticks)
+	uint32_t hash;		  //!< Hash of the last position in the round
+} match_sim_result_t;
+
+typedef struct match_sim_player_t {
+	player_t *player;			  //!< Simulated player
+	cJSON *keypresses;			  //!< Scripted keypress events: [[time, direction(, arrival)], ...]
+	cJSON *keypress_next;		  //!< Next keypress event to apply in this round
+	match_sim_result_t end;		  //!< Result of the round
+	match_sim_result_t reference; //!< Result of the round with all keypress events on time
+} match_sim_player_t;
+
+static void match_sim_round(game_t *game, match_sim_player_t *players, int count, unsigned int max_ticks, bool on_time);
+static bool match_sim_verify(game_t *game, match_sim_player_t *players, int count);
+
+/**
+ * Run a headless simulation of a match, from scripted keypress events.
+ * The rounds are not paced by the wall clock, nor synchronized over the network - every tick runs
+ * immediately, using the same code as the match scheduler (match_tick_players()).
+ * Ticks per second, crash and finish events and the players' results are reported in the log.
+ *
+ * Keypress events can also arrive late (like over a slow network), which makes the match roll back
+ * and recalculate the positions following them. Every such round is then played twice - first with all
+ * keypress events on time - and the results of both must be the same, otherwise the simulation fails.
+ *
+ * The script is a JSON file:
+ * {
+ *     "speed": 3,            # game speed (affects the starting positions)
+ *     "rounds": 1,           # number of rounds to play
+ *     "max_ticks": 100000,   # stop the round after this many ticks
+ *     "players": [
+ *         {
+ *             "id": 10,      # player ID (affects the starting positions)
+ *             "name": "Bot",
+ *             # keypress events in every round: [time, direction(, arrival)], sorted by time
+ *             # time is the position timestamp (5 per tick), direction is 1 (left) or 0 (forward)
+ *             # arrival (optional) is the position timestamp when the event is received, sorted too
+ *             "keypresses": [[100, 1], [180, 0, 200]]
+ *         }
+ *     ]
+ * }
+ *
+ * @return false if the script couldn't be loaded, or late keypress events changed the results
+ */
+bool match_sim_run(const char *script_file) {
+	bool ret					= false;
+	game_t *game				= NULL;
+	match_sim_player_t *players = NULL;
+	int count					= 0;
+
+	cJSON *script = file_read_json(script_file);
+	if (script == NULL)
+		LT_ERR(E, return false, "Simulation script '%s' cannot be read", script_file);
+
+	MALLOC(game, sizeof(*game), goto cleanup);
+	game->is_server = true;
+	game->speed		= SETTINGS->game_speed;
+	game->rounds	= 1;
+	json_read_uint(script, "speed", &game->speed);
+	json_read_uint(script, "rounds", &game->rounds);
+	strncpy2(game->name, "Simulation", GAME_NAME_LEN);
+	strncpy2(game->key, "SIM", GAME_KEY_LEN);
+	match_snapshot_init(game);
+
+	cJSON *players_json = cJSON_GetObjectItem(script, "players");
+	if (cJSON_GetArraySize(players_json) == 0)
+		LT_ERR(E, goto cleanup, "Simulation script has no players");
+	MALLOC(players, sizeof(*players) * cJSON_GetArraySize(players_json), goto cleanup);
+
+	bool any_late = false;
+	cJSON *player_json;
+	cJSON_ArrayForEach(player_json, players_json) {
+		cJSON *name		 = cJSON_GetObjectItem(player_json, "name");
+		player_t *player = player_init(game, cJSON_IsString(name) ? name->valuestring : "Bot");
+		if (player == NULL)
+			goto cleanup;
+		json_read_uint(player_json, "id", &player->id);
+		DL_APPEND(game->players, player);
+		players[count].player	  = player;
+		players[count].keypresses = cJSON_GetObjectItem(player_json, "keypresses");
+		count++;
+
+		// check the keypress events: [time, direction(, arrival)]
+		cJSON *keypresses = players[count - 1].keypresses;
+		if (keypresses != NULL && !cJSON_IsArray(keypresses))
+			LT_ERR(E, goto cleanup, "Simulation script: 'keypresses' of player #%u is not an array", player->id);
+		int index = 0;
+		cJSON *keypress;
+		cJSON_ArrayForEach(keypress, keypresses) {
+			int size   = cJSON_GetArraySize(keypress);
+			bool valid = cJSON_IsArray(keypress) && (size == 2 || size == 3);
+			for (int i = 0; i < size && valid; i++) {
+				cJSON *item = cJSON_GetArrayItem(keypress, i);
+				valid		= cJSON_IsNumber(item) && item->valuedouble >= 0;
+			}
+			if (!valid)
+				LT_ERR(E, goto cleanup, "Simulation script: keypress #%d of player #%u is invalid", index, player->id);
+			if (size == 3)
+				any_late = true;
+			index++;
+		}
+	}
+
+	unsigned int max_ticks = 100000;
+	json_read_uint(script, "max_ticks", &max_ticks);
+
+	LT_I("Sim: running %u round(s) with %d player(s) at speed %u", game->rounds, count, game->speed);
+	bool desync = false;
+	for (game->round = 1; game->round <= game->rounds; game->round++) {
+		if (any_late) {
+			match_sim_round(game, players, count, max_ticks, true);
+			for (int i = 0; i < count; i++) {
+				players[i].reference = players[i].end;
+			}
+		}
+		match_sim_round(game, players, count, max_ticks, false);
+		if (any_late && !match_sim_verify(game, players, count))
+			desync = true;
+	}
+	ret = !desync;
+	// the replays are written in the background
+	match_replay_wait();
+
+cleanup:
+	if (game != NULL) {
+		player_t *player, *tmp;
+		DL_FOREACH_SAFE(game->players, player, tmp) {
+			DL_DELETE(game->players, player);
+			player_free(player);
+		}
+		match_snapshot_free(game);
+		SDL_DestroyMutex(game->mutex);
+		free(game);
+	}
+	free(players);
+	cJSON_Delete(script);
+	return ret;
+}
+
+/**
+ * Play a single round. If 'on_time' is set, the arrival time of keypress events is ignored,
+ * and the round is not reported nor recorded (it's only the reference for match_sim_verify()).
+ */
+static void match_sim_round(
+	game_t *game,
+	match_sim_player_t *players,
+	int count,
+	unsigned int max_ticks,
+	bool on_time
+) {
+	// initialize the round, like match_round_init() and match_count_wait() do
+	for (int i = 0; i < count; i++) {
+		players[i].keypress_next = players[i].keypresses != NULL ? players[i].keypresses->child : NULL;
+		players[i].end.time		 = 0;
+		players[i].player->state = PLAYER_READY;
+	}
+	SDL_WITH_MUTEX(game->mutex) {
+		game->lap				= 1;
+		game->round_ticks		= 0;
+		game->match_any_playing = false;
+		player_reset_round(game);
+	}
+	for (int i = 0; i < count; i++) {
+		players[i].player->state = PLAYER_PLAYING;
+	}
+	if (!on_time)
+		match_replay_start(game);
+
+	uint64_t perf_start = SDL_GetPerformanceCounter();
+	unsigned int ticks	= 0;
+	bool any_in_round	= true;
+	while (any_in_round && ticks < max_ticks) {
+		// apply the keypress events that the simulation has reached (like remote keypress packets)
+		for (int i = 0; i < count; i++) {
+			player_t *player = players[i].player;
+			SDL_WITH_MUTEX(player->mutex) {
+				while (players[i].keypress_next != NULL) {
+					cJSON *keypress		 = players[i].keypress_next;
+					cJSON *arrival		 = cJSON_GetArrayItem(keypress, 2);
+					unsigned int time	 = cJSON_GetArrayItem(keypress, 0)->valueint;
+					bool left			 = cJSON_GetArrayItem(keypress, 1)->valueint == PLAYER_POS_LEFT;
+					unsigned int receive = !on_time && arrival != NULL ? arrival->valueint : time;
+					if (receive > PLAYER_POS(player, 0)->time)
+						break;
+					player_position_remote_keypress(player, time, left ? PLAYER_POS_LEFT : PLAYER_POS_FORWARD);
+					players[i].keypress_next = keypress->next;
+				}
+			}
+		}
+
+		bool state_changed = false;
+		any_in_round	   = match_tick_players(game, &state_changed);
+		ticks++;
+		if (!state_changed)
+			continue;
+		// record the crash/finish events
+		for (int i = 0; i < count; i++) {
+			player_t *player = players[i].player;
+			if (players[i].end.time != 0 || player->state == PLAYER_PLAYING)
+				continue;
+			players[i].end.time = player->time;
+			if (on_time)
+				continue;
+			LT_I(
+				"Sim (round %u): #%u '%s' %s @ %u (lap %u)",
+				game->round,
+				player->id,
+				player->name,
+				player->state == PLAYER_FINISHED ? "finished" : "crashed",
+				player->time,
+				PLAYER_POS(player, 0)->lap
+			);
+		}
+	}
+
+	uint64_t perf_diff = SDL_GetPerformanceCounter() - perf_start;
+	for (int i = 0; i < count; i++) {
+		players[i].end.state = players[i].player->state;
+		players[i].end.hash	 = player_position_hash(PLAYER_POS(players[i].player, 0));
+	}
+	if (on_time)
+		return;
+	match_replay_finish(game);
+	double elapsed = (double)perf_diff / (double)SDL_GetPerformanceFrequency();
+	LT_I(
+		"Sim (round %u): %u ticks in %.3f ms (%.0f ticks/s)",
+		game->round,
+		ticks,
+		elapsed * 1000.0,
+		elapsed > 0.0 ? ticks / elapsed : 0.0
+	);
+	if (any_in_round)
+		LT_W("Sim (round %u): stopped after %u ticks, some players are still playing", game->round, ticks);
+
+	// report the players' results (the match doesn't score the rounds, so neither does the simulation)
+	for (int i = 0; i < count; i++) {
+		player_t *player   = players[i].player;
+		const char *result = "still playing";
+		if (player->state == PLAYER_FINISHED)
+			result = "finished";
+		else if (player->state == PLAYER_CRASHED)
+			result = "crashed";
+		LT_I(
+			"Sim (round %u): #%u '%s' - %s @ %u, lap %u",
+			game->round,
+			player->id,
+			player->name,
+			result,
+			players[i].end.time,
+			PLAYER_POS(player, 0)->lap
+		);
+	}
+}
+
+/**
+ * Check that the round played with late keypress events has the same results
+ * as the reference round, with all keypress events on time.
+ */
+static bool match_sim_verify(game_t *game, match_sim_player_t *players, int count) {
+	bool ret = true;
+	for (int i = 0; i < count; i++) {
+		match_sim_result_t *end = &players[i].end;
+		match_sim_result_t *ref = &players[i].reference;
+		if (end->state == ref->state && end->time == ref->time && end->hash == ref->hash)
+			continue;
+		LT_E(
+			"Sim (round %u): #%u desynced by late keypress events - state %d @ %u (hash %08x), "
+			"expected state %d @ %u (hash %08x)",
+			game->round,
+			players[i].player->id,
+			end->state,
+			end->time,
+			end->hash,
+			ref->state,
+			ref->time,
+			ref->hash
+		);
+		ret = false;
+	}
+	if (ret)
+		LT_I("Sim (round %u): late keypress events verified", game->round);
+	return ret;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-4.
+
+#include "match.h"
+
+/**
+ * Initialize the snapshot triple buffer. The match thread publishes the players' state after every tick,
+ * and the UI renders it without locking the game or the players. One buffer is written by the match thread,
+ * one is read by the UI, the third one holds the latest published snapshot. Publishing and acquiring only swap
+ * the indexes (atomically), so neither side ever waits for the other one.
+ * Snapshots are copies only, without pointers to the players - they stay valid after the players are freed.
+ */
+void match_snapshot_init(game_t *game) {
+	game->snapshot_write = 0;
+	game->snapshot_read	 = 1;
+	SDL_AtomicSet(&game->snapshot_latest, 2);
+}
+
+void match_snapshot_free(game_t *game) {
+	for (int i = 0; i < 3; i++) {
+		free(game->snapshot[i].players);
+		game->snapshot[i].players = NULL;
+		game->snapshot[i].count	  = 0;
+		game->snapshot[i].size	  = 0;
+	}
+}
+
+/**
+ * Copy the players' current state to the write buffer and publish it to the renderer.
+ * Must be called by the match thread, with the game locked.
+ */
+void match_snapshot_publish(game_t *game) {
+	match_snapshot_t *snapshot = &game->snapshot[game->snapshot_write];
+
+	player_t *player;
+	unsigned int count = 0;
+	DL_FOREACH(game->players, player) {
+		if (player->is_in_round || (player->state & PLAYER_IN_MATCH_MASK))
+			count++;
+	}
+
+	// the write buffer is owned by the match thread, so it can be reallocated safely
+	if (count > snapshot->size) {
+		player_snapshot_t *players = realloc(snapshot->players, sizeof(*players) * count);
+		if (players == NULL)
+			LT_ERR(E, return, "Memory allocation failed for the match snapshot (%u players)", count);
+		snapshot->players = players;
+		snapshot->size	  = count;
+	}
+
+	snapshot->count = 0;
+	DL_FOREACH(game->players, player) {
+		if (!player->is_in_round && (player->state & PLAYER_IN_MATCH_MASK) == 0)
+			continue;
+		player_snapshot_t *item = &snapshot->players[snapshot->count++];
+		SDL_WITH_MUTEX(player->mutex) {
+			item->id		  = player->id;
+			item->color		  = player->color;
+			item->state		  = player->state;
+			item->is_in_round = player->is_in_round;
+			item->time		  = player->time;
+			item->lap		  = PLAYER_POS(player, 0)->lap;
+			// unroll the trail ring buffer
+			unsigned int head = player->trail_head;
+			unsigned int num  = PLAYER_TRAIL_NUM - head;
+			memcpy(item->trail, player->trail + head, sizeof(*item->trail) * num);
+			memcpy(item->trail + num, player->trail, sizeof(*item->trail) * head);
+			item->trail_steps	= player->trail_steps;
+			item->trail_version = player->trail_version;
+		}
+	}
+	snapshot->tick = ++game->snapshot_tick;
+
+	// make the snapshot visible before publishing its index
+	SDL_MemoryBarrierRelease();
+	int latest			 = SDL_AtomicSet(&game->snapshot_latest, (int)game->snapshot_write | MATCH_SNAPSHOT_FRESH);
+	game->snapshot_write = latest & ~MATCH_SNAPSHOT_FRESH;
+}
+
+/**
+ * Get the latest published snapshot. Must be called by the UI thread.
+ * The snapshot stays valid (and unchanged) until the next call.
+ */
+match_snapshot_t *match_snapshot_acquire(game_t *game) {
+	if (SDL_AtomicGet(&game->snapshot_latest) & MATCH_SNAPSHOT_FRESH) {
+		int latest			= SDL_AtomicSet(&game->snapshot_latest, (int)game->snapshot_read);
+		game->snapshot_read = latest & ~MATCH_SNAPSHOT_FRESH;
+		SDL_MemoryBarrierAcquire();
+	}
+	return &game->snapshot[game->snapshot_read];
+}
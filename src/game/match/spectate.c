@@ -0,0 +1,298 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-7.
+
+#include "match.h"
+
+// player entry flags
+#define SPECTATE_POS_ABSOLUTE (1 << 0) //!< Position is absolute (uint16_t x, y, angle), not a delta (int8_t)
+#define SPECTATE_POS_STATE	  (1 << 1) //!< Player state and lap number follow (uint8_t each)
+
+// positions are quantized to 1/4 px
+#define SPECTATE_POS_SCALE 4
+
+static void spectate_quantize(player_t *player, player_spectate_t *out);
+static unsigned int spectate_encode(player_t *player, bool keyframe, uint8_t *data);
+static void spectate_send(game_t *game, pkt_spectate_frame_t *pkt, unsigned int len, net_endpoint_t *endpoint);
+
+/**
+ * Server: stream the players' positions to spectators, 'spectate_rate' frames per second.
+ * Must be called by the match thread, after a tick, with the game locked.
+ *
+ * Positions are quantized and delta-compressed against the previous frame - players that didn't move
+ * take no space at all. Every frame carries at most SPECTATE_FRAME_PLAYERS players, picked round-robin,
+ * so the bandwidth stays bounded regardless of the player count. Keyframes (at round start, or when
+ * a spectator joins) contain all players' absolute state, in as many frames as needed.
+ */
+void match_spectate_tick(game_t *game) {
+	if (SETTINGS->spectate_rate <= 0)
+		return;
+	unsigned int ticks_per_frame = 1000 / (max(game->delay, 1) * SETTINGS->spectate_rate);
+	if (game->spectate_keyframe) {
+		match_spectate_keyframe(game, game->round_ticks, NULL);
+		game->spectate_keyframe = false;
+		game->spectate_next		= 0;
+		return;
+	}
+	if (game->round_ticks % max(ticks_per_frame, 1) != 0)
+		return;
+
+	pkt_spectate_frame_t pkt = {
+		.hdr.type = PKT_SPECTATE_FRAME,
+		.tick	  = game->round_ticks,
+	};
+	unsigned int len = 0;
+	player_t *player;
+
+	// send the changed players, starting where the previous frame stopped
+	unsigned int start = game->spectate_next;
+	unsigned int index = 0;
+	bool full		   = false;
+	for (int pass = 0; pass < 2 && !full; pass++) {
+		index = 0;
+		DL_FOREACH(game->players, player) {
+			if (!player->is_in_round && (player->state & PLAYER_IN_MATCH_MASK) == 0)
+				continue;
+			unsigned int i = index++;
+			// 1st pass: players from 'start' onwards, 2nd pass: players before 'start'
+			if ((pass == 0) != (i >= start))
+				continue;
+			if (pkt.count == SPECTATE_FRAME_PLAYERS) {
+				// frame is full, continue from this player next time
+				game->spectate_next = i;
+				full				= true;
+				break;
+			}
+			unsigned int entry_len;
+			SDL_WITH_MUTEX(player->mutex) {
+				entry_len = spectate_encode(player, false, pkt.data + len);
+			}
+			if (entry_len == 0)
+				// player didn't change
+				continue;
+			len += entry_len;
+			pkt.count++;
+		}
+	}
+	if (!full)
+		game->spectate_next = 0;
+	if (pkt.count != 0)
+		spectate_send(game, &pkt, len, NULL);
+}
+
+/**
+ * Send a keyframe - all players' absolute state, in as many frames as needed.
+ * Must be called with the game locked.
+ *
+ * @param tick round tick of the keyframe
+ * @param endpoint spectator to send the keyframe to, NULL to send to all spectators (via the game thread);
+ * a keyframe sent to a single spectator doesn't change the streamed state that delta frames are relative to
+ */
+void match_spectate_keyframe(game_t *game, unsigned int tick, net_endpoint_t *endpoint) {
+	pkt_spectate_frame_t pkt = {
+		.hdr.type = PKT_SPECTATE_FRAME,
+		.tick	  = tick,
+		.keyframe = 1,
+	};
+	unsigned int len = 0;
+	player_t *player;
+	DL_FOREACH(game->players, player) {
+		if (!player->is_in_round && (player->state & PLAYER_IN_MATCH_MASK) == 0)
+			continue;
+		if (pkt.count == SPECTATE_FRAME_PLAYERS) {
+			spectate_send(game, &pkt, len, endpoint);
+			pkt.keyframe++;
+			pkt.count = 0;
+			len		  = 0;
+		}
+		SDL_WITH_MUTEX(player->mutex) {
+			player_spectate_t ref = player->spectate;
+			len += spectate_encode(player, true, pkt.data + len);
+			if (endpoint != NULL)
+				// other spectators still decode the next frames relative to the streamed state
+				player->spectate = ref;
+		}
+		pkt.count++;
+	}
+	spectate_send(game, &pkt, len, endpoint);
+}
+
+/**
+ * Client: apply a frame received from the server to the spectated players.
+ * The trail is filled by interpolating between frames, so it has the same length as when playing.
+ * The players' state is then published to the renderer, like after a match tick.
+ *
+ * @return whether the frame was valid
+ */
+bool match_spectate_apply(game_t *game, pkt_spectate_frame_t *pkt) {
+	const uint8_t *data = pkt->data;
+	const uint8_t *end	= (const uint8_t *)pkt + pkt->hdr.len;
+	bool valid			= true;
+	bool state_changed	= pkt->keyframe != 0;
+	player_t *player;
+
+	SDL_LOCK_MUTEX(game->mutex);
+	// number of ticks covered by this frame
+	unsigned int ticks = 1;
+	if (pkt->keyframe == 0 && pkt->tick > game->spectate_tick)
+		ticks = min(pkt->tick - game->spectate_tick, PLAYER_TRAIL_NUM);
+	game->spectate_tick = pkt->tick;
+	if (pkt->keyframe == 1) {
+		// the keyframe contains all players of the round
+		DL_FOREACH(game->players, player) {
+			player->is_in_round = false;
+		}
+	}
+
+	// decode the entries, updating the reference state
+	for (unsigned int i = 0; i < pkt->count; i++) {
+		if (end - data < 2)
+			goto invalid;
+		unsigned int id	   = data[0];
+		unsigned int flags = data[1];
+		data += 2;
+		unsigned int entry_len = ((flags & SPECTATE_POS_ABSOLUTE) ? 6 : 3) + ((flags & SPECTATE_POS_STATE) ? 2 : 0);
+		if (end - data < (ptrdiff_t)entry_len)
+			goto invalid;
+
+		DL_SEARCH_SCALAR(game->players, player, id, id);
+		if (player == NULL) {
+			data += entry_len;
+			continue;
+		}
+		SDL_WITH_MUTEX(player->mutex) {
+			player_spectate_t *ref = &player->spectate;
+			if (flags & SPECTATE_POS_ABSOLUTE) {
+				ref->x	   = data[0] | (data[1] << 8);
+				ref->y	   = data[2] | (data[3] << 8);
+				ref->angle = data[4] | (data[5] << 8);
+				data += 6;
+			} else {
+				ref->x += (int8_t)data[0];
+				ref->y += (int8_t)data[1];
+				ref->angle = (ref->angle + 360 + (int8_t)data[2]) % 360;
+				data += 3;
+			}
+			if (flags & SPECTATE_POS_STATE) {
+				ref->state = data[0];
+				ref->lap   = data[1];
+				data += 2;
+				player->state		= ref->state;
+				player->is_in_round = (ref->state & PLAYER_IN_MATCH_MASK) != 0;
+				state_changed		= true;
+			}
+		}
+	}
+
+	// move all streamed players to their reference state
+	DL_FOREACH(game->players, player) {
+		if (!player->is_in_round)
+			continue;
+		SDL_WITH_MUTEX(player->mutex) {
+			player_pos_t *pos = PLAYER_POS(player, 0);
+			float x			  = (float)player->spectate.x / SPECTATE_POS_SCALE;
+			float y			  = (float)player->spectate.y / SPECTATE_POS_SCALE;
+			pos->x			  = x;
+			pos->y			  = y;
+			pos->angle		  = player->spectate.angle;
+			pos->lap		  = player->spectate.lap;
+			pos->time		  = pkt->tick * 5;
+			player->time	  = pos->time;
+			game->lap		  = max(game->lap, pos->lap);
+
+			if (pkt->keyframe != 0) {
+				// start a new trail
+				for (unsigned int i = 0; i < PLAYER_TRAIL_NUM; i++) {
+					player->trail[i].x = x;
+					player->trail[i].y = y;
+				}
+				player->trail_version++;
+				continue;
+			}
+			// interpolate the skipped ticks
+			player_trail_t prev = *PLAYER_TRAIL(player, 0);
+			for (unsigned int step = 1; step <= ticks; step++) {
+				player->trail_head	  = (player->trail_head + PLAYER_TRAIL_NUM - 1) % PLAYER_TRAIL_NUM;
+				player_trail_t *trail = PLAYER_TRAIL(player, 0);
+				trail->x			  = prev.x + (x - prev.x) * step / ticks;
+				trail->y			  = prev.y + (y - prev.y) * step / ticks;
+				player->trail_steps++;
+			}
+		}
+	}
+
+	// publish the frame for the UI
+	match_snapshot_publish(game);
+	goto unlock;
+
+invalid:
+	LT_W("Spectate: frame @ tick %u is invalid", pkt->tick);
+	valid = false;
+unlock:
+	SDL_UNLOCK_MUTEX(game->mutex);
+	if (valid)
+		match_send_ui_update(game, state_changed ? MATCH_UPDATE_STATE : MATCH_UPDATE_STEP_PLAYERS);
+	return valid;
+}
+
+static void spectate_quantize(player_t *player, player_spectate_t *out) {
+	player_pos_t *pos = PLAYER_POS(player, 0);
+	out->x			  = (int)min(max(round(pos->x * SPECTATE_POS_SCALE), 0.0), (double)UINT16_MAX);
+	out->y			  = (int)min(max(round(pos->y * SPECTATE_POS_SCALE), 0.0), (double)UINT16_MAX);
+	out->angle		  = pos->angle % 360;
+	out->lap		  = pos->lap;
+	out->state		  = player->state;
+}
+
+/**
+ * Encode the player's current state as a frame entry, relative to the previously streamed state.
+ * The streamed state is then updated.
+ *
+ * Entry format: uint8_t id, uint8_t flags, then either int8_t dx, dy, dangle,
+ * or (SPECTATE_POS_ABSOLUTE) uint16_t x, y, angle; then (SPECTATE_POS_STATE) uint8_t state, lap.
+ *
+ * @return entry length, at most PKT_SPECTATE_POS_MAX_LEN (0 if the player didn't change)
+ */
+static unsigned int spectate_encode(player_t *player, bool keyframe, uint8_t *data) {
+	player_spectate_t cur;
+	spectate_quantize(player, &cur);
+	player_spectate_t *ref = &player->spectate;
+
+	int dx		  = cur.x - ref->x;
+	int dy		  = cur.y - ref->y;
+	int dangle	  = ((int)cur.angle - (int)ref->angle + 540) % 360 - 180;
+	bool state	  = keyframe || cur.state != ref->state || cur.lap != ref->lap;
+	bool absolute = keyframe || dx < INT8_MIN || dx > INT8_MAX || dy < INT8_MIN || dy > INT8_MAX ||
+					dangle < INT8_MIN || dangle > INT8_MAX;
+	if (!state && !absolute && dx == 0 && dy == 0 && dangle == 0)
+		return 0;
+
+	uint8_t *p = data;
+	*p++	   = (uint8_t)player->id;
+	*p++	   = (absolute ? SPECTATE_POS_ABSOLUTE : 0) | (state ? SPECTATE_POS_STATE : 0);
+	if (absolute) {
+		*p++ = cur.x & 0xFF;
+		*p++ = cur.x >> 8;
+		*p++ = cur.y & 0xFF;
+		*p++ = cur.y >> 8;
+		*p++ = cur.angle & 0xFF;
+		*p++ = cur.angle >> 8;
+	} else {
+		*p++ = (uint8_t)(int8_t)dx;
+		*p++ = (uint8_t)(int8_t)dy;
+		*p++ = (uint8_t)(int8_t)dangle;
+	}
+	if (state) {
+		*p++ = (uint8_t)cur.state;
+		*p++ = (uint8_t)cur.lap;
+	}
+	*ref = cur;
+	return p - data;
+}
+
+static void spectate_send(game_t *game, pkt_spectate_frame_t *pkt, unsigned int len, net_endpoint_t *endpoint) {
+	pkt->hdr.len = offsetof(pkt_spectate_frame_t, data) + len;
+	if (endpoint != NULL)
+		net_pkt_send(endpoint, (pkt_t *)pkt);
+	else
+		// the game thread sends it to the spectators' endpoints
+		net_pkt_send_pipe(game->endpoints, (pkt_t *)pkt);
+}
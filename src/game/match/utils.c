@@ -20,22 +20,40 @@ bool match_check_ready(game_t *game) {
 	return players_count != 0 && players_count == ready_count;
 }
 
-bool match_wait_ready(game_t *game) {
-	if (match_check_ready(game) || game->match_stop)
-		return true;
-	LT_I("Match (round %u): players are not ready", game->round);
-	do {
-		SDL_SemWaitTimeout(game->ready_sem, 500);
-	} while (!match_check_ready(game) && !game->match_stop);
-	return true;
-}
-
-void match_send_sdl_event(game_t *game, int code) {
+void match_send_ui_update(game_t *game, int code) {
 	if (game->match_stop || game->is_server)
 		return;
-	SDL_Event user = {
-		.user.type = SDL_USEREVENT_MATCH,
-		.user.code = code,
+	// the UI pulls the update (and the latest snapshot) on its next frame
+	wakeup_ui_match(code);
+}
+
+/**
+ * Send hashes of all players' simulated state to the server, every MATCH_HASH_INTERVAL ticks.
+ * The hashed positions are MATCH_HASH_DELAY ticks old, so that late keypress events
+ * had the time to arrive. On mismatch, the server responds with the authoritative state
+ * of the diverged player (see process_pkt_player_hash()).
+ */
+void match_send_hashes(game_t *game) {
+	pkt_player_hash_t pkt = {
+		.hdr.type = PKT_PLAYER_HASH,
 	};
-	SDL_PushEvent(&user);
+	player_t *player;
+	SDL_WITH_MUTEX(game->mutex) {
+		if (game->round_ticks % MATCH_HASH_INTERVAL != 0)
+			continue;
+		DL_FOREACH(game->players, player) {
+			bool send = false;
+			SDL_WITH_MUTEX(player->mutex) {
+				unsigned int delay = min(MATCH_HASH_DELAY, player->pos_num - 1);
+				if (!player->is_in_round || game->round_ticks <= delay)
+					continue;
+				pkt.id	 = player->id;
+				pkt.tick = game->round_ticks - delay;
+				pkt.hash = player_position_hash(PLAYER_POS(player, delay));
+				send	 = true;
+			}
+			if (send)
+				net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt);
+		}
+	}
 }
@@ -15,6 +15,9 @@ static bool process_pkt_player_keypress(game_t *game, pkt_player_keypress_t *rec
 static bool process_pkt_player_leave(game_t *game, pkt_player_leave_t *recv_pkt, net_endpoint_t *source);
 static bool process_pkt_request_send_data(game_t *game, pkt_request_send_data_t *recv_pkt, net_endpoint_t *source);
 static bool process_pkt_request_time_sync(game_t *game, pkt_request_time_sync_t *recv_pkt, net_endpoint_t *source);
+static bool process_pkt_player_hash(game_t *game, pkt_player_hash_t *recv_pkt, net_endpoint_t *source);
+static bool process_pkt_player_state(game_t *game, pkt_player_state_t *recv_pkt, net_endpoint_t *source);
+static bool process_pkt_spectate_frame(game_t *game, pkt_spectate_frame_t *recv_pkt, net_endpoint_t *source);
 
 const game_process_t process_list[] = {
 	NULL,
@@ -33,6 +36,11 @@ const game_process_t process_list[] = {
 	(game_process_t)process_pkt_player_leave,	   // PKT_PLAYER_LEAVE
 	(game_process_t)process_pkt_request_send_data, // PKT_REQUEST_SEND_DATA
 	(game_process_t)process_pkt_request_time_sync, // PKT_REQUEST_TIME_SYNC
+	(game_process_t)process_pkt_player_hash,	   // PKT_PLAYER_HASH
+	(game_process_t)process_pkt_player_state,	   // PKT_PLAYER_STATE
+	(game_process_t)process_pkt_spectate_frame,	   // PKT_SPECTATE_FRAME
+	NULL,										   // PKT_REDIRECT
+	(game_process_t)send_err_invalid_state,		   // PKT_CLUSTER_NODE (server-only)
 };
 
 /**
@@ -45,6 +53,10 @@ const game_process_t process_list[] = {
  */
 bool game_process_packet(game_t *game, pkt_t *pkt, net_endpoint_t *source) {
 	BUILD_BUG_ON(sizeof(process_list) != sizeof(*process_list) * PKT_MAX);
+	bool broadcast;
+	if (game->upstream != NULL && game_relay_process_packet(game, pkt, source, &broadcast))
+		// relay: packet handled by mirroring the upstream game
+		return broadcast;
 	game_process_t func = process_list[pkt->hdr.type];
 	if (func == NULL)
 		// no processing function defined
@@ -81,8 +93,9 @@ static bool process_pkt_ping(game_t *game, pkt_ping_t *recv_pkt, net_endpoint_t
 		source->ping_rtt   = local_time - recv_pkt->send_time;
 		source->time_delta = (long long)recv_pkt->send_time - (long long)recv_pkt->recv_time + source->ping_rtt / 2;
 		LT_D("Ping: RTT = %u ms, delta = %lld ms", source->ping_rtt, source->time_delta);
-		if (source->ping_sem)
-			SDL_SemPost(source->ping_sem);
+		// wake up the match waiting for ping responses
+		source->ping_ok = true;
+		match_wake(game);
 	}
 
 	return false;
@@ -119,7 +132,7 @@ static bool process_pkt_game_start(game_t *game, pkt_game_start_t *recv_pkt, net
 		return false;
 	game->state = GAME_STARTING;
 
-	// client: start the match thread, send event to UI
+	// client: start the match, send event to UI
 	match_init(game);
 	return true;
 }
@@ -134,9 +147,15 @@ static bool process_pkt_game_stop(game_t *game, pkt_game_stop_t *recv_pkt, net_e
 		if (player->state == PLAYER_DISCONNECTED)
 			// delete disconnected players
 			game_del_player(game, player);
-		else
+		else if (player->is_spectator)
+			// read-only spectators (relays) never take part in the match
+			player->state = PLAYER_SPECTATING;
+		else {
 			// force player states to IDLE
+			if (player->state == PLAYER_SPECTATING && player->endpoint != NULL)
+				player->endpoint->spectators--;
 			player->state = PLAYER_IDLE;
+		}
 	}
 
 	if (game->is_server)
@@ -167,10 +186,13 @@ static bool process_pkt_game_start_round(game_t *game, pkt_game_start_round_t *r
 		}
 	}
 
-	// client: post start_at to match thread
-	game->count_at = recv_pkt->count_at;
-	game->start_at = recv_pkt->start_at;
-	SDL_SemPost(game->start_at_sem);
+	// client: post start_at to the match
+	SDL_WITH_MUTEX(game->mutex) {
+		game->count_at		 = recv_pkt->count_at;
+		game->start_at		 = recv_pkt->start_at;
+		game->start_at_ready = true;
+	}
+	match_wake(game);
 	return false;
 }
 
@@ -196,17 +218,26 @@ static bool process_pkt_player_new(game_t *game, pkt_player_new_t *recv_pkt, net
 	if (player == NULL)
 		goto error;
 
-	if (game->state != GAME_IDLE)
+	if (game->state != GAME_IDLE || recv_pkt->is_spectator)
 		// players joining ongoing games can only spectate
 		player->state = PLAYER_SPECTATING;
+	player->is_spectator = recv_pkt->is_spectator;
 
 	// add to players list
 	player->endpoint = source;
 	game_add_player(game, player);
+
+	if (player->state == PLAYER_SPECTATING) {
+		source->spectators++;
+		// stream a keyframe to the new spectator
+		SDL_WITH_MUTEX(game->mutex) {
+			game->spectate_keyframe = true;
+		}
+	}
 	return false;
 
 error:
-	free(player);
+	player_free(player);
 	if (game->is_server)
 		// do not send from client
 		game_send_error(game, source, GAME_ERR_SERVER_ERROR);
@@ -261,7 +292,7 @@ static bool process_pkt_player_data(game_t *game, pkt_player_data_t *recv_pkt, n
 
 	// client: update remote player lap number
 	if (!game->is_server && !player->is_local)
-		player->pos[0].lap = recv_pkt->lap;
+		PLAYER_POS(player, 0)->lap = recv_pkt->lap;
 
 	// client: add to players list
 	if (is_new_player)
@@ -271,8 +302,8 @@ static bool process_pkt_player_data(game_t *game, pkt_player_data_t *recv_pkt, n
 		// before broadcasting from server, clear 'is_local'
 		player->is_local = false;
 
-	// post the ready state semaphore
-	SDL_SemPost(game->ready_sem);
+	// wake up the match waiting for ready state
+	match_wake(game);
 
 	return true;
 }
@@ -329,6 +360,15 @@ static bool process_pkt_request_send_data(game_t *game, pkt_request_send_data_t
 	player_t *updated_player	  = NULL;
 	if (recv_pkt->updated_player)
 		DL_SEARCH_SCALAR(game->players, updated_player, id, recv_pkt->updated_player);
+	if (join_endpoint != NULL) {
+		// the endpoint might have left (or the game was recycled) before the request got here
+		net_endpoint_t *item;
+		DL_FOREACH(game->endpoints, item) {
+			if (item == join_endpoint)
+				break;
+		}
+		join_endpoint = item;
+	}
 
 	if (join_endpoint != NULL || updated_game) {
 		// server: endpoint joined
@@ -370,8 +410,8 @@ static bool process_pkt_request_send_data(game_t *game, pkt_request_send_data_t
 			pkt.is_local = updated_player->endpoint == endpoint;
 			net_pkt_send(endpoint, (pkt_t *)&pkt);
 		}
-		// post the ready state semaphore
-		SDL_SemPost(game->ready_sem);
+		// wake up the match waiting for ready state
+		match_wake(game);
 	} else if (recv_pkt->updated_player != 0) {
 		pkt_player_leave_t pkt = {
 			.hdr.type = PKT_PLAYER_LEAVE,
@@ -402,3 +442,121 @@ static bool process_pkt_request_time_sync(game_t *game, pkt_request_time_sync_t
 
 	return false;
 }
+
+static bool process_pkt_player_hash(game_t *game, pkt_player_hash_t *recv_pkt, net_endpoint_t *source) {
+	if (game->state != GAME_PLAYING)
+		// round is not running
+		return false;
+	if (!game->is_server)
+		// client: send packet to other endpoint (only from the match)
+		return source->type == NET_ENDPOINT_PIPE;
+
+	pkt_player_state_t pkt = {
+		.hdr.type = PKT_PLAYER_STATE,
+		.id		  = recv_pkt->id,
+		.tick	  = recv_pkt->tick,
+	};
+	bool mismatch = false;
+	SDL_WITH_MUTEX(game->mutex) {
+		player_t *player = game_get_player_by_id(game, recv_pkt->id);
+		if (player == NULL || recv_pkt->tick > game->round_ticks)
+			// player not found, or the client is ahead of the server
+			continue;
+		unsigned int index = game->round_ticks - recv_pkt->tick;
+		SDL_WITH_MUTEX(player->mutex) {
+			if (!player->is_in_round || index >= player->pos_num)
+				// position already left the rollback window
+				continue;
+			player_pos_t *pos = PLAYER_POS(player, index);
+			if (player_position_hash(pos) == recv_pkt->hash)
+				continue;
+			mismatch			= true;
+			pkt.time			= pos->time;
+			pkt.angle			= pos->angle;
+			pkt.speed			= pos->speed;
+			pkt.x				= pos->x;
+			pkt.y				= pos->y;
+			pkt.lap				= pos->lap;
+			pkt.direction		= pos->direction;
+			pkt.lap_can_advance = pos->lap_can_advance;
+			// the position is frozen if the player stopped before this tick
+			pkt.state = pos->time < recv_pkt->tick * 5 ? player->state : PLAYER_PLAYING;
+		}
+	}
+
+	if (mismatch) {
+		// server: send the authoritative state to the diverged client only
+		LT_W("Player: #%u desync @ tick %u on %s, resyncing", recv_pkt->id, recv_pkt->tick, net_endpoint_str(source));
+		net_pkt_send(source, (pkt_t *)&pkt);
+	}
+	return false;
+}
+
+static bool process_pkt_player_state(game_t *game, pkt_player_state_t *recv_pkt, net_endpoint_t *source) {
+	if (game->is_server || game->state != GAME_PLAYING)
+		// server: only the server's state is authoritative
+		return false;
+
+	SDL_WITH_MUTEX(game->mutex) {
+		player_t *player = game_get_player_by_id(game, recv_pkt->id);
+		if (player == NULL || recv_pkt->tick > game->round_ticks)
+			continue;
+		unsigned int index = game->round_ticks - recv_pkt->tick;
+		SDL_WITH_MUTEX(player->mutex) {
+			if (!player->is_in_round || index == 0 || index >= player->pos_num) {
+				LT_W("Player: #%u state @ tick %u is out of the rollback window, dropping", player->id, recv_pkt->tick);
+				continue;
+			}
+			// overwrite the diverged position
+			player_pos_t *pos	 = PLAYER_POS(player, index);
+			pos->time			 = recv_pkt->time;
+			pos->angle			 = recv_pkt->angle;
+			pos->speed			 = recv_pkt->speed;
+			pos->x				 = recv_pkt->x;
+			pos->y				 = recv_pkt->y;
+			pos->lap			 = recv_pkt->lap;
+			pos->direction		 = recv_pkt->direction;
+			pos->lap_can_advance = recv_pkt->lap_can_advance;
+			pos->confirmed		 = true;
+			pos->direction_set	 = true;
+			player_position_store_trail(player, index);
+
+			if (recv_pkt->state == PLAYER_PLAYING) {
+				// recalculate all positions following this one
+				player->dirty_time = pos->time;
+				player->is_dirty   = true;
+				player_position_flush(player);
+			} else {
+				// the player stopped at this position - freeze all following positions
+				player->state			= recv_pkt->state;
+				player->time			= pos->time;
+				player->lap_can_advance = pos->lap_can_advance;
+				for (; index > 0; index--) {
+					*PLAYER_POS(player, index - 1) = *pos;
+					player_position_store_trail(player, index - 1);
+				}
+				// the trail might have been drawn already
+				player->trail_version++;
+			}
+			LT_W("Player: #%u state corrected @ tick %u", player->id, recv_pkt->tick);
+		}
+	}
+	return false;
+}
+
+static bool process_pkt_spectate_frame(game_t *game, pkt_spectate_frame_t *recv_pkt, net_endpoint_t *source) {
+	if (!game->is_server)
+		// client: apply the frame, show the match on keyframes
+		return source->type != NET_ENDPOINT_PIPE && match_spectate_apply(game, recv_pkt) && recv_pkt->keyframe == 1;
+	if (source->type != NET_ENDPOINT_PIPE)
+		// server: only accept frames from the match
+		return false;
+
+	// server: send to all spectators' endpoints
+	net_endpoint_t *endpoint;
+	DL_FOREACH(game->endpoints, endpoint) {
+		if (endpoint->spectators != 0)
+			net_pkt_send(endpoint, (pkt_t *)recv_pkt);
+	}
+	return false;
+}
@@ -0,0 +1,144 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-2.
+
+#include "player.h"
+
+double player_cos[360];
+double player_sin[360];
+
+/**
+ * Fill the trigonometric lookup tables, used by both the scalar
+ * and the batch simulation. Must be called once, before any match starts.
+ */
+void player_trig_init(void) {
+	for (unsigned int angle = 0; angle < 360; angle++) {
+		double angle_rad  = angle * M_PI / 180.0;
+		player_cos[angle] = cos(angle_rad);
+		player_sin[angle] = sin(angle_rad);
+	}
+}
+
+/**
+ * Start a new (empty) simulation batch.
+ */
+void player_batch_begin(player_batch_t *batch) {
+	batch->count = 0;
+}
+
+/**
+ * Lock the player and add it to the batch. This is the first half of a player's tick:
+ * future keypress events are processed, late keypresses are recalculated (player_position_flush())
+ * and the position history is shifted (player_position_shift()). The latest position is then loaded
+ * into the batch lanes, to be calculated by player_batch_step() - the second half of the tick,
+ * equivalent to player_position_calculate(player, 1) for the players that are still playing.
+ *
+ * @return false if the batch is full (player not added nor locked)
+ */
+bool player_batch_add(player_batch_t *batch, player_t *player) {
+	if (batch->count >= PLAYER_BATCH_MAX)
+		return false;
+	SDL_LOCK_MUTEX(player->mutex);
+
+	// process any future keypress events *before* shifting the position history
+	player_position_future_keypress(player);
+	// recalculate once after all late keypresses
+	player_position_flush(player);
+	// save the position leaving the rollback window - it's final from now on
+	unsigned int i	  = batch->count++;
+	batch->retired[i] = *PLAYER_POS(player, player->pos_num - 1);
+	// only step the players that are still alive (position unchanged - player is already gone)
+	batch->shifted[i] = player_position_shift(player);
+	bool active		  = batch->shifted[i] && player->state == PLAYER_PLAYING;
+
+	player_pos_t *prev	= PLAYER_POS(player, 1);
+	batch->player[i]	= player;
+	batch->active[i]	= active;
+	batch->changed[i]	= false;
+	batch->angle[i]		= prev->angle;
+	batch->speed[i]		= prev->speed;
+	batch->x[i]			= prev->x;
+	batch->y[i]			= prev->y;
+	batch->direction[i] = prev->direction;
+	return true;
+}
+
+/**
+ * Calculate the next position of every player in the batch.
+ *
+ * The movement is calculated for all lanes at once, without branches, so that the compiler
+ * can vectorize the loop. The results are bit-identical to player_position_calculate().
+ * Lanes that leave the track surface or end close to the finish or half-lap gate are flagged
+ * by a collision grid lookup, and checked using the scalar functions afterwards.
+ */
+void player_batch_step(player_batch_t *batch) {
+	unsigned int count			   = batch->count;
+	unsigned int *restrict angle_v = batch->angle;
+	double *restrict speed_v	   = batch->speed;
+	double *restrict x_v		   = batch->x;
+	double *restrict y_v		   = batch->y;
+	const int *restrict dir_v	   = batch->direction;
+	int *restrict event_v		   = batch->event;
+	const track_t *track		   = TRACK;
+
+	for (unsigned int i = 0; i < count; i++) {
+		int left		   = dir_v[i] == PLAYER_POS_LEFT;
+		unsigned int angle = angle_v[i] + (left ? 2 : 0);
+		angle			   = angle > 359 ? angle - 360 : angle;
+		double speed	   = speed_v[i];
+		double speed_left  = speed > 3.0 ? speed - 0.048 : speed;
+		double speed_fwd   = speed < 7.0 ? speed + 0.052 : speed;
+		speed			   = left ? speed_left : speed_fwd;
+
+		double prev_x = x_v[i];
+		double prev_y = y_v[i];
+		double x	  = prev_x + player_cos[angle] * speed;
+		double y	  = prev_y - player_sin[angle] * speed;
+
+		// off the surface, or close to the half-lap or finish gate
+		unsigned int cell = track_get_cell(track, x, y);
+		int event		  = (cell & (TRACK_CELL_SURFACE | TRACK_CELL_GATE)) != TRACK_CELL_SURFACE;
+
+		angle_v[i] = angle;
+		speed_v[i] = speed;
+		x_v[i]	   = x;
+		y_v[i]	   = y;
+		event_v[i] = event;
+	}
+
+	// store the results, run precise checks where needed
+	for (unsigned int i = 0; i < count; i++) {
+		if (!batch->active[i])
+			continue;
+		player_t *player   = batch->player[i];
+		player_pos_t *prev = PLAYER_POS(player, 1);
+		player_pos_t *next = PLAYER_POS(player, 0);
+
+		next->time		= prev->time + 5;
+		next->angle		= batch->angle[i];
+		next->speed		= batch->speed[i];
+		next->x			= batch->x[i];
+		next->y			= batch->y[i];
+		next->lap		= prev->lap;
+		next->direction = prev->direction;
+		next->confirmed = player->is_local;
+		player->time	= next->time;
+
+		if (batch->event[i]) {
+			if (player_position_check_lap(player, prev, next))
+				batch->changed[i] = true;
+			else if (player_position_check_collision(player, next))
+				batch->changed[i] = true;
+		}
+		next->lap_can_advance = player->lap_can_advance;
+		player_position_store_trail(player, 0);
+	}
+}
+
+/**
+ * Unlock all players in the batch.
+ */
+void player_batch_end(player_batch_t *batch) {
+	for (unsigned int i = 0; i < batch->count; i++) {
+		SDL_UNLOCK_MUTEX(batch->player[i]->mutex);
+	}
+	batch->count = 0;
+}
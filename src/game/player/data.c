@@ -83,17 +83,20 @@ void player_fill_data_pkt(game_t *game, player_t *player, pkt_player_data_t *pkt
 	pkt->id	   = player->id;
 	pkt->color = player->color;
 	pkt->state = player->state;
-	pkt->lap   = player->pos[0].lap;
+	pkt->lap   = PLAYER_POS(player, 0)->lap;
 	strcpy(pkt->name, player->name);
 }
 
 void player_reset_round(game_t *game) {
-	BUILD_BUG_ON(PLAYER_POS_NUM < 20);
+	BUILD_BUG_ON(PLAYER_TRAIL_NUM < 20);
 	player_t *player, *player_0 = NULL, *player_1 = NULL;
 	int player_count = 0;
 	DL_FOREACH(game->players, player) {
 		if (player->state != PLAYER_READY)
 			continue;
+		// rewind the position history
+		player->pos_head   = 0;
+		player->trail_head = 0;
 		// find the 1st and 2nd players that are ready
 		if (player_0 == NULL)
 			player_0 = player;
@@ -110,8 +113,8 @@ void player_reset_round(game_t *game) {
 	uint32_t seed = (player_0->id * game->round * game->speed * 10) * 1103515245 + 12345;
 	seed		  = (uint32_t)(seed / 65536) % 32768;
 	// apply the position
-	player_0->pos[0].y = 310.0 + (seed % 4) * 20.0;
-	LT_I("Player #%u starting Y position: %f", player_0->id, player_0->pos[0].y);
+	PLAYER_POS(player_0, 0)->y = TRACK->start_y + (seed % 4) * 20.0;
+	LT_I("Player #%u starting Y position: %f", player_0->id, PLAYER_POS(player_0, 0)->y);
 
 	if (player_count > 2) {
 		int player_idx = 0;
@@ -122,18 +125,18 @@ void player_reset_round(game_t *game) {
 				player_idx++;
 				continue;
 			}
-			player->pos[0].y = player_0->pos[0].y + (double)player_idx * 20.0;
+			PLAYER_POS(player, 0)->y = PLAYER_POS(player_0, 0)->y + (double)player_idx * 20.0;
 			if (player_idx >= 4)
-				player->pos[0].y += 10.0;
-			while (player->pos[0].y > 370.0)
-				player->pos[0].y -= 80.0;
+				PLAYER_POS(player, 0)->y += 10.0;
+			while (PLAYER_POS(player, 0)->y > TRACK->start_y + 60.0)
+				PLAYER_POS(player, 0)->y -= 80.0;
 			player_idx++;
 		}
 	} else if (player_count == 2 && player_1 != NULL) {
-		if (player_0->pos[0].y >= 350.0)
-			player_1->pos[0].y = player_0->pos[0].y - 40.0;
+		if (PLAYER_POS(player_0, 0)->y >= TRACK->start_y + 40.0)
+			PLAYER_POS(player_1, 0)->y = PLAYER_POS(player_0, 0)->y - 40.0;
 		else
-			player_1->pos[0].y = player_0->pos[0].y + 40.0;
+			PLAYER_POS(player_1, 0)->y = PLAYER_POS(player_0, 0)->y + 40.0;
 	}
 
 	DL_FOREACH(game->players, player) {
@@ -141,29 +144,32 @@ void player_reset_round(game_t *game) {
 			continue;
 		// reset player data
 		player->lap_can_advance = false;
+		player->is_dirty		= false;
 		player->is_in_round		= true;
 		player->round_points	= 0;
 		// reset all player positions
-		player->pos[0].time		 = 0;
-		player->pos[0].angle	 = 0;
-		player->pos[0].speed	 = 1.0;
-		player->pos[0].x		 = 320.0;
-		player->pos[0].lap		 = 1;
-		player->pos[0].direction = PLAYER_POS_FORWARD;
-		player->pos[0].confirmed = true;
-		for (int i = 1; i < 20; i++) {
-			player->pos[i]	 = player->pos[0];
-			player->pos[i].x = 320 - (i + 1);
+		player_pos_t *head	  = PLAYER_POS(player, 0);
+		head->time			  = 0;
+		head->angle			  = 0;
+		head->speed			  = 1.0;
+		head->x				  = TRACK->start_x;
+		head->lap			  = 1;
+		head->direction		  = PLAYER_POS_FORWARD;
+		head->direction_set	  = false;
+		head->confirmed		  = true;
+		head->lap_can_advance = false;
+		for (unsigned int i = 1; i < player->pos_num; i++) {
+			*PLAYER_POS(player, i) = *head;
 		}
-		for (int i = 20; i < PLAYER_POS_NUM; i++) {
-			player->pos[i]	 = player->pos[0];
-			player->pos[i].x = 300;
+		// reset the trail
+		for (int i = 0; i < PLAYER_TRAIL_NUM; i++) {
+			PLAYER_TRAIL(player, i)->x = (float)(i == 0 ? head->x : i < 20 ? head->x - (i + 1) : head->x - 20.0);
+			PLAYER_TRAIL(player, i)->y = (float)head->y;
 		}
+		player->trail_version++;
 		// reset all future keypress events
-		player_keypress_t *keypress, *tmp;
-		DL_FOREACH_SAFE(player->keypress, keypress, tmp) {
-			DL_DELETE(player->keypress, keypress);
-			free(keypress);
-		}
+		player->keypress_head	 = 0;
+		player->keypress_count	 = 0;
+		player->keypress_dropped = 0;
 	}
 }
@@ -4,14 +4,18 @@
 
 player_t *player_init(game_t *game, char *name) {
 	player_t *player;
-	MALLOC(player, sizeof(*player), goto cleanup);
+	ARENA_MALLOC(game->arena, player, sizeof(*player), return NULL);
+	player->game = game;
+
+	// allocate the rollback state history
+	player->pos_num = max(SETTINGS->rollback_ticks, 2);
+	ARENA_MALLOC(game->arena, player->pos, sizeof(*player->pos) * player->pos_num, goto cleanup);
 
 	SDL_WITH_MUTEX(player->mutex) {
-		player->game  = game;
 		player->state = PLAYER_IDLE;
 
 		do {
-			player->id = rand() % (100 - 10) + 10; // 10..99
+			player->id = rand() % GAME_PLAYERS_MAX + 10; // 10..99
 		} while (game_get_player_by_id(game, player->id) != NULL);
 
 		if (name != NULL)
@@ -31,41 +35,73 @@ void player_free(player_t *player) {
 	if (player == NULL)
 		return;
 	SDL_DestroyMutex(player->mutex);
-	SDL_DestroyTexture(player->texture);
-	free(player);
+	arena_t *arena = player->game->arena;
+	if (player->pos != NULL)
+		arena_free(arena, player->pos, sizeof(*player->pos) * player->pos_num);
+	arena_free(arena, player, sizeof(*player));
 }
 
 /**
- * Shift the player position history by 1.
+ * Shift the player state history and the trail by 1.
  * Position 0 is not modified (will equal position 1).
  * Last position is removed from the list.
  *
- * The positions are not shifted if the player's head is the same
- * as their tail (player crashed/finished, and has already disappeared).
+ * Both histories are ring buffers, so only the head indexes are moved,
+ * and the new heads are initialized with the previous ones.
+ *
+ * The positions are not shifted if the player's trail head is the same
+ * as its tail (player crashed/finished, and has already disappeared).
  *
  * @return whether positions were shifted
  */
 bool player_position_shift(player_t *player) {
-	if (player->pos[PLAYER_POS_NUM - 1].x == player->pos[0].x &&
-		player->pos[PLAYER_POS_NUM - 1].y == player->pos[0].y) {
+	player_trail_t *trail_head = PLAYER_TRAIL(player, 0);
+	player_trail_t *trail_tail = PLAYER_TRAIL(player, PLAYER_TRAIL_NUM - 1);
+	if (trail_tail->x == trail_head->x && trail_tail->y == trail_head->y) {
 		player->is_in_round = false;
 		return false;
 	}
-	memmove(&player->pos[1], &player->pos[0], sizeof(*player->pos) * (PLAYER_POS_NUM - 1));
+	// move the heads back by one position, overwriting the tails
+	player_pos_t *head		 = PLAYER_POS(player, 0);
+	player->pos_head		 = (player->pos_head + player->pos_num - 1) % player->pos_num;
+	*PLAYER_POS(player, 0)	 = *head;
+	player->trail_head		 = (player->trail_head + PLAYER_TRAIL_NUM - 1) % PLAYER_TRAIL_NUM;
+	*PLAYER_TRAIL(player, 0) = *trail_head;
+	player->trail_steps++;
+	// the new head only continues the previous direction, and isn't confirmed by any keypress yet
+	PLAYER_POS(player, 0)->direction_set = false;
+	PLAYER_POS(player, 0)->confirmed	 = player->is_local;
 	return true;
 }
 
 /**
- * (Re)calculate player positions, starting at 'start'.
+ * Copy the state at 'index' to the trail, if the trail is long enough to contain it.
+ */
+void player_position_store_trail(player_t *player, unsigned int index) {
+	if (index >= PLAYER_TRAIL_NUM)
+		return;
+	player_pos_t *pos	  = PLAYER_POS(player, index);
+	player_trail_t *trail = PLAYER_TRAIL(player, index);
+	trail->x			  = (float)pos->x;
+	trail->y			  = (float)pos->y;
+}
+
+/**
+ * (Re)calculate player positions, starting at index 'start'.
  * The starting position is not modified, but used to calculate
  * all following positions (higher time/lower index).
- * 'start' must point to player->pos[1] through player->pos[PLAYER_POS_NUM-1].
+ * 'start' must be an index between 1 and player->pos_num-1.
  * The player's state will be updated based on lap advancement and collision.
+ * Trail positions are rewritten, as long as they're still in the trail.
+ * Directions set by keypress events are kept, the others continue the previous direction.
  */
-bool player_position_calculate(player_t *player, player_pos_t *start) {
+bool player_position_calculate(player_t *player, unsigned int start) {
 	bool changed = false;
-	for (player_pos_t *next = start - 1; next >= player->pos; next--) {
-		player_pos_t *prev = next + 1;
+	// restore the state snapshot
+	player->lap_can_advance = PLAYER_POS(player, start)->lap_can_advance;
+	for (unsigned int index = start; index > 0; index--) {
+		player_pos_t *prev = PLAYER_POS(player, index);
+		player_pos_t *next = PLAYER_POS(player, index - 1);
 
 		next->time	= prev->time + 5;
 		next->angle = prev->angle;
@@ -81,17 +117,20 @@ bool player_position_calculate(player_t *player, player_pos_t *start) {
 				next->speed += 0.052;
 		}
 
-		double angle_rad = next->angle * M_PI / 180.0;
-		next->x			 = prev->x + cos(angle_rad) * next->speed;
-		next->y			 = prev->y - sin(angle_rad) * next->speed;
-		next->lap		 = prev->lap;
-		next->direction	 = prev->direction;
-		next->confirmed	 = player->is_local;
+		next->x			= prev->x + player_cos[next->angle] * next->speed;
+		next->y			= prev->y - player_sin[next->angle] * next->speed;
+		next->lap		= prev->lap;
+		// keep the directions of the keypress events waiting for this recalculation
+		if (!next->direction_set)
+			next->direction = prev->direction;
+		next->confirmed = player->is_local;
 
 		if (player_position_check_lap(player, prev, next))
 			changed = true;
 		else if (player_position_check_collision(player, next))
 			changed = true;
+		next->lap_can_advance = player->lap_can_advance;
+		player_position_store_trail(player, index - 1);
 	}
 	return changed;
 }
@@ -103,13 +142,13 @@ bool player_position_calculate(player_t *player, player_pos_t *start) {
  */
 bool player_position_check_lap(player_t *player, player_pos_t *prev, player_pos_t *next) {
 	// check if the player moves through half a lap
-	if (!player->lap_can_advance && prev->y > 240.0 && next->y <= 240.0) {
+	if (!player->lap_can_advance && track_gate_crossed(&TRACK->half_lap, prev->x, prev->y, next->x, next->y)) {
 		player->lap_can_advance = true;
 		LT_I("Player: #%u not stuck anymore @ %u", player->id, next->time);
 	}
 
 	// check if the player finishes a lap
-	if (prev->x <= 319.0 && next->x > 319.0) {
+	if (track_gate_crossed(&TRACK->finish, prev->x, prev->y, next->x, next->y)) {
 		if (prev->lap == 4) {
 			player->state = PLAYER_FINISHED;
 			LT_I("Player: #%u finished the race @ %u", player->id, next->time);
@@ -128,28 +167,12 @@ bool player_position_check_lap(player_t *player, player_pos_t *prev, player_pos_
 }
 
 /**
- * Check if the position collides with a wall.
+ * Check if the position collides with a wall (i.e. leaves the track surface).
  * Update the player state if the player crashes.
  */
 bool player_position_check_collision(player_t *player, player_pos_t *pos) {
-	if (pos->y <= 92.0 || pos->y >= 388.0 ||
-		(pos->x >= 150.0 && pos->x <= 489.0 && pos->y >= 188.0 && pos->y <= 292.0)) {
-		goto crash;
-	}
-	double dy = pos->y - 240.0;
-	if (pos->x <= 150.0) {
-		double dx	= pos->x - 150.0;
-		double dist = sqrt(dx * dx + dy * dy);
-		if (dist <= 52.0 || dist >= 148.0)
-			goto crash;
-	} else if (pos->x >= 489.0) {
-		double dx	= pos->x - 489.0;
-		double dist = sqrt(dx * dx + dy * dy);
-		if (dist <= 52.0 || dist >= 148.0)
-			goto crash;
-	}
-	return false;
-crash:
+	if (track_get_cell(TRACK, pos->x, pos->y) & TRACK_CELL_SURFACE)
+		return false;
 	player->state = PLAYER_CRASHED;
 	LT_I("Player: #%u crashed into the wall @ %u", player->id, pos->time);
 	return true;
@@ -158,42 +181,47 @@ crash:
 /**
  * Process a keypress event.
  * Apply the new direction to the player's position.
- * If 'time' points to any of the previous positions, recalculate.
+ * If 'time' points to any of the previous positions, mark the following positions
+ * as dirty - they will be recalculated by player_position_flush().
  * Mark all positions older than 'time' as confirmed.
  *
  * @return whether an unconfirmed position was found by the specified time
  */
 bool player_position_process_direction(player_t *player, unsigned int time, player_pos_dir_t direction) {
 	player_pos_t *player_pos = NULL;
+	unsigned int index		 = 0;
 
-	if (player->pos[0].time == time) {
+	if (PLAYER_POS(player, 0)->time == time) {
 		// keypress time is in the latest player position, no need for recalculation
-		player_pos			  = &player->pos[0];
-		player_pos->direction = direction;
+		player_pos				  = PLAYER_POS(player, 0);
+		player_pos->direction	  = direction;
+		player_pos->direction_set = true;
 	} else {
 		// keypress time points to an older position, find it and recalculate all following positions
-		int max_time = 0;
-		for (int i = 1; i < PLAYER_POS_NUM; i++) {
-			max_time = max(max_time, player->pos[i].time);
-			if (player->pos[i].time != time)
+		for (index = 1; index < player->pos_num; index++) {
+			if (PLAYER_POS(player, index)->time != time)
 				continue;
-			player_pos = &player->pos[i];
+			player_pos = PLAYER_POS(player, index);
 			break;
 		}
 		if (player_pos == NULL || player_pos->confirmed)
 			return false;
 		// set the player's direction starting in the position at 'time'
-		player_pos->direction = direction;
-		// consider the player still alive
-		player->state = PLAYER_PLAYING;
-		// recalculate all positions following this one
-		// will also reassign player state
-		player_position_calculate(player, player_pos);
+		player_pos->direction	  = direction;
+		player_pos->direction_set = true;
+		// mark all positions following this one for recalculation
+		// (multiple keypresses are recalculated once, from the earliest one,
+		// keeping the directions set by the later ones)
+		if (!player->is_dirty || time < player->dirty_time) {
+			player->dirty_time = time;
+			player->is_dirty   = true;
+		}
 	}
 
 	player_pos->confirmed = true;
 	// mark all older positions as confirmed
-	while (++player_pos < player->pos + PLAYER_POS_NUM) {
+	while (++index < player->pos_num) {
+		player_pos = PLAYER_POS(player, index);
 		if (player_pos->confirmed)
 			break;
 		player_pos->confirmed = true;
@@ -201,6 +229,37 @@ bool player_position_process_direction(player_t *player, unsigned int time, play
 	return true;
 }
 
+/**
+ * Recalculate the positions marked as dirty by late keypress events,
+ * starting at the earliest affected tick.
+ * Called once per match tick, and before drawing the player.
+ *
+ * @return whether any positions were recalculated
+ */
+bool player_position_flush(player_t *player) {
+	if (!player->is_dirty)
+		return false;
+	player->is_dirty = false;
+
+	unsigned int index;
+	for (index = 1; index < player->pos_num; index++) {
+		if (PLAYER_POS(player, index)->time == player->dirty_time)
+			break;
+	}
+	if (index >= player->pos_num)
+		// position already left the rollback window
+		return false;
+
+	// consider the player still alive
+	player->state = PLAYER_PLAYING;
+	// recalculate all positions following this one
+	// will also reassign player state
+	player_position_calculate(player, index);
+	// the trail might have been drawn already
+	player->trail_version++;
+	return true;
+}
+
 /**
  * Process a keypress event from a remote player.
  * If 'time' points to a yet-non-existent position, save the keypress
@@ -217,17 +276,62 @@ bool player_position_remote_keypress(player_t *player, unsigned int time, player
 		// keypress event processed, nothing else to do
 		return true;
 
+	if (time <= PLAYER_POS(player, 0)->time) {
+		// position already left the rollback window (or was confirmed before), it won't be found later either
+		player->keypress_dropped++;
+		LT_W("Player: #%u keypress @ %u is too old, dropping (%u dropped)", player->id, time, player->keypress_dropped);
+		return false;
+	}
+
 	// position not found, the client's loop must be running too quickly
-	player_keypress_t *keypress;
-	MALLOC(keypress, sizeof(*keypress), return false);
-	// save the 'future' keypress in the player's structure
-	keypress->time		= time;
-	keypress->direction = direction;
-	DL_APPEND(player->keypress, keypress);
+	if (player->keypress_count >= PLAYER_KEYPRESS_NUM) {
+		player->keypress_dropped++;
+		LT_W("Player: #%u keypress buffer full, dropping (%u dropped)", player->id, player->keypress_dropped);
+		return false;
+	}
+
+	// save the 'future' keypress in the player's structure, keeping the buffer sorted by time
+	// (keypress events usually arrive in order, so this rarely needs to move anything)
+	unsigned int i = player->keypress_count++;
+	for (; i > 0; i--) {
+		player_keypress_t *prev = &player->keypress[(player->keypress_head + i - 1) % PLAYER_KEYPRESS_NUM];
+		if (prev->time <= time)
+			break;
+		player->keypress[(player->keypress_head + i) % PLAYER_KEYPRESS_NUM] = *prev;
+	}
+	player_keypress_t *keypress = &player->keypress[(player->keypress_head + i) % PLAYER_KEYPRESS_NUM];
+	keypress->time				= time;
+	keypress->direction			= direction;
 
 	return false;
 }
 
+/**
+ * Calculate a compact hash (FNV-1a) of the simulated state at the position, for desync detection.
+ * All fields affecting the following positions are hashed, byte order-independently.
+ */
+uint32_t player_position_hash(player_pos_t *pos) {
+	uint64_t fields[8] = {
+		pos->time,
+		pos->angle,
+		pos->lap,
+		pos->direction,
+		pos->lap_can_advance,
+	};
+	memcpy(&fields[5], &pos->speed, sizeof(double));
+	memcpy(&fields[6], &pos->x, sizeof(double));
+	memcpy(&fields[7], &pos->y, sizeof(double));
+
+	uint32_t hash = 2166136261u;
+	for (unsigned int i = 0; i < sizeof(fields) / sizeof(*fields); i++) {
+		for (unsigned int shift = 0; shift < 64; shift += 8) {
+			hash ^= (fields[i] >> shift) & 0xFF;
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
 /**
  * Process any future keypress events saved for this player.
  *
@@ -238,34 +342,20 @@ bool player_position_future_keypress(player_t *player) {
 		// ignore key events for local players
 		return false;
 
-	bool processed = false;
-	player_keypress_t *keypress, *tmp;
-	DL_FOREACH_SAFE(player->keypress, keypress, tmp) {
-		if (player_position_process_direction(player, keypress->time, keypress->direction) == false)
-			// keypress not processed
-			continue;
-		// keypress processed, remove from the list
-		DL_DELETE(player->keypress, keypress);
-		free(keypress);
-		processed = true;
+	bool processed		  = false;
+	unsigned int pos_time = PLAYER_POS(player, 0)->time;
+	// consume keypress events in order, as long as the simulation has reached them
+	while (player->keypress_count != 0) {
+		player_keypress_t *keypress = &player->keypress[player->keypress_head];
+		if (keypress->time > pos_time)
+			break;
+		if (player_position_process_direction(player, keypress->time, keypress->direction))
+			processed = true;
+		else
+			player->keypress_dropped++;
+		// remove from the buffer
+		player->keypress_head = (player->keypress_head + 1) % PLAYER_KEYPRESS_NUM;
+		player->keypress_count--;
 	}
 	return processed;
 }
-
-bool player_loop(player_t *player) {
-	// process any future keypress events *before* shifting the position history
-	player_position_future_keypress(player);
-
-	if (!player_position_shift(player))
-		// position unchanged - player is already gone
-		return false;
-
-	// calculate positions for players that are still alive
-	bool changed = false;
-	if (player->state == PLAYER_PLAYING) {
-		changed		 = player_position_calculate(player, &player->pos[1]);
-		player->time = player->pos[0].time;
-	}
-
-	return changed;
-}
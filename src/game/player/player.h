@@ -9,17 +9,42 @@
 typedef struct pkt_player_new_t pkt_player_new_t;
 typedef struct pkt_player_data_t pkt_player_data_t;
 
+/**
+ * Get a pointer to the player's state, 'index' ticks back in the rollback history.
+ * Index 0 is the latest state, player->pos_num-1 is the oldest one.
+ */
+#define PLAYER_POS(player, index) (&(player)->pos[((player)->pos_head + (index)) % (player)->pos_num])
+
+/**
+ * Get a pointer to the player's trail position, 'index' ticks back in the trail.
+ * Index 0 is the latest position (same tick as PLAYER_POS(player, 0)),
+ * PLAYER_TRAIL_NUM-1 is the oldest one.
+ */
+#define PLAYER_TRAIL(player, index) (&(player)->trail[((player)->trail_head + (index)) % PLAYER_TRAIL_NUM])
+
+extern double player_cos[360];
+extern double player_sin[360];
+
+// batch.c
+void player_trig_init(void);
+void player_batch_begin(player_batch_t *batch);
+bool player_batch_add(player_batch_t *batch, player_t *player);
+void player_batch_step(player_batch_t *batch);
+void player_batch_end(player_batch_t *batch);
+
 // player.c
 player_t *player_init(game_t *game, char *name);
 void player_free(player_t *player);
 bool player_position_shift(player_t *player);
-bool player_position_calculate(player_t *player, player_pos_t *start);
+void player_position_store_trail(player_t *player, unsigned int index);
+bool player_position_calculate(player_t *player, unsigned int start);
 bool player_position_check_lap(player_t *player, player_pos_t *prev, player_pos_t *next);
 bool player_position_check_collision(player_t *player, player_pos_t *pos);
 bool player_position_process_direction(player_t *player, unsigned int time, player_pos_dir_t direction);
+bool player_position_flush(player_t *player);
 bool player_position_remote_keypress(player_t *player, unsigned int time, player_pos_dir_t direction);
 bool player_position_future_keypress(player_t *player);
-bool player_loop(player_t *player);
+uint32_t player_position_hash(player_pos_t *pos);
 
 // data.c
 void player_set_color(game_t *game, player_t *player);
@@ -27,30 +27,43 @@ typedef enum player_pos_dir_t {
 } player_pos_dir_t;
 
 typedef struct player_pos_t {
-	unsigned int time;	//!< Position timestamp (ticks)
-	unsigned int angle; //!< Turning angle, 0..359, CCW (0: left)
-	double speed;		//!< Moving speed, 1.0..7.0
-	double x;			//!< Position X
-	double y;			//!< Position Y
-	unsigned int lap;	//!< Lap number, 1..4
-	int direction;		//!< Movement direction for the next position
-	bool confirmed;		//!< Whether the remote player's movement direction is confirmed
+	unsigned int time;	  //!< Position timestamp (ticks)
+	unsigned int angle;	  //!< Turning angle, 0..359, CCW (0: left)
+	double speed;		  //!< Moving speed, 1.0..7.0
+	double x;			  //!< Position X
+	double y;			  //!< Position Y
+	unsigned int lap;	  //!< Lap number, 1..4
+	int direction;		  //!< Movement direction for the next position
+	bool confirmed;		  //!< Whether the remote player's movement direction is confirmed
+	bool direction_set;	  //!< Whether 'direction' was set by a keypress event (kept when recalculating)
+	bool lap_can_advance; //!< Whether the player moved through half a lap (state snapshot)
 } player_pos_t;
 
+typedef struct player_trail_t {
+	float x; //!< Position X
+	float y; //!< Position Y
+} player_trail_t;
+
 typedef struct player_keypress_t {
 	unsigned int time;			//!< Position timestamp (ticks)
 	player_pos_dir_t direction; //!< Movement direction for the next position
-
-	struct player_keypress_t *prev, *next;
 } player_keypress_t;
 
+typedef struct player_spectate_t {
+	int x;				  //!< Position X (1/SPECTATE_POS_SCALE px)
+	int y;				  //!< Position Y (1/SPECTATE_POS_SCALE px)
+	unsigned int angle;	  //!< Turning angle, 0..359
+	unsigned int lap;	  //!< Lap number, 1..4
+	player_state_t state; //!< Player state
+} player_spectate_t;
+
 typedef struct player_t {
-	SDL_mutex *mutex;	  //!< Mutex locking this player's data
-	SDL_Texture *texture; //!< SDL texture
+	SDL_mutex *mutex; //!< Mutex locking this player's data
 
 	game_t *game;			  //!< Handle to the game
 	net_endpoint_t *endpoint; //!< Client handle (server only)
 	player_state_t state;	  //!< Current player state
+	bool is_spectator;		  //!< Whether the player joined as a read-only spectator (server only)
 
 	// client-only parameters
 	bool is_local;		   //!< Whether player is controlled on this device
@@ -62,11 +75,23 @@ typedef struct player_t {
 	unsigned int color;				//!< Player's line color
 
 	// round state, controlled by the match thread
-	unsigned int time;				  //!< Total playing time (ticks)
-	player_pos_t pos[PLAYER_POS_NUM]; //!< Position history
-	player_keypress_t *keypress;	  //!< Linked list for future keypress events
-	bool lap_can_advance;			  //!< Whether the player moved through half a lap
-	bool is_in_round;				  //!< Whether the player is playing in this round (not crashed, not finished)
+	unsigned int time;								 //!< Total playing time (ticks)
+	player_pos_t *pos;								 //!< Rollback state history (ring buffer, see PLAYER_POS())
+	unsigned int pos_num;							 //!< Rollback window length (ticks)
+	unsigned int pos_head;							 //!< Index of the latest position in the state history
+	player_trail_t trail[PLAYER_TRAIL_NUM];			 //!< Trail drawn on the board (ring buffer, see PLAYER_TRAIL())
+	unsigned int trail_head;						 //!< Index of the latest position in the trail
+	unsigned int trail_steps;						 //!< Number of times the trail was shifted
+	unsigned int trail_version;						 //!< Incremented when drawn trail positions are rewritten
+	player_keypress_t keypress[PLAYER_KEYPRESS_NUM]; //!< Future keypress events (ring buffer, sorted by time)
+	unsigned int keypress_head;						 //!< Index of the oldest future keypress event
+	unsigned int keypress_count;					 //!< Number of future keypress events
+	unsigned int keypress_dropped;					 //!< Number of keypress events dropped in this round
+	unsigned int dirty_time;						 //!< Earliest tick changed by a late keypress (if 'is_dirty')
+	bool is_dirty;									 //!< Whether positions need recalculation from 'dirty_time'
+	bool lap_can_advance;							 //!< Whether the player moved through half a lap
+	bool is_in_round;								 //!< Whether the player is still playing in this round
+	player_spectate_t spectate;						 //!< Last state streamed to spectators (quantized)
 
 	// scores, controlled by the match thread
 	int round_points; //!< Points in the current round
@@ -75,3 +100,32 @@ typedef struct player_t {
 
 	struct player_t *prev, *next;
 } player_t;
+
+typedef struct player_batch_t {
+	unsigned int count;						//!< Number of players in the batch
+	player_t *player[PLAYER_BATCH_MAX];		//!< Players in the batch (locked until player_batch_end())
+	bool active[PLAYER_BATCH_MAX];			//!< Whether the player is stepped by the kernel (still playing)
+	bool changed[PLAYER_BATCH_MAX];			//!< Whether the player's state changed in this step
+	bool shifted[PLAYER_BATCH_MAX];			//!< Whether the player's position history was shifted
+	player_pos_t retired[PLAYER_BATCH_MAX];	//!< Position that left the rollback window (if shifted)
+
+	// lane data (structure of arrays)
+	unsigned int angle[PLAYER_BATCH_MAX]; //!< Turning angle, 0..359
+	double speed[PLAYER_BATCH_MAX];		  //!< Moving speed
+	double x[PLAYER_BATCH_MAX];			  //!< Position X
+	double y[PLAYER_BATCH_MAX];			  //!< Position Y
+	int direction[PLAYER_BATCH_MAX];	  //!< Movement direction for the next position
+	int event[PLAYER_BATCH_MAX];		  //!< Whether the lap/collision check needs to run for this lane
+} player_batch_t;
+
+typedef struct player_snapshot_t {
+	unsigned int id;						//!< Unique ID within the game
+	unsigned int color;						//!< Player's line color
+	player_state_t state;					//!< Player state at the snapshot's tick
+	bool is_in_round;						//!< Whether the player is still playing in this round
+	unsigned int time;						//!< Total playing time (ticks)
+	unsigned int lap;						//!< Lap number, 1..4
+	player_trail_t trail[PLAYER_TRAIL_NUM]; //!< Trail drawn on the board (index 0 is the latest position)
+	unsigned int trail_steps;				//!< Number of times the trail was shifted
+	unsigned int trail_version;				//!< Incremented when drawn trail positions are rewritten
+} player_snapshot_t;
@@ -0,0 +1,158 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-11.
+
+#include "game.h"
+
+static int game_pool_thread(void *param);
+
+static SDL_mutex *pool_mutex   = NULL;	//!< Mutex locking the pool
+static SDL_cond *pool_cond	   = NULL;	//!< Condition for waking up the refill thread
+static game_t *pool_list	   = NULL;	//!< Idle games, ready to be claimed
+static unsigned int pool_count = 0;		//!< Number of games in the pool
+static bool pool_running	   = false;	//!< Whether the pool is started
+
+/**
+ * Server: fill the pool of idle games, and start a thread refilling it.
+ *
+ * Every game in the pool is fully created - its arena, pipe and thread are ready - but not listed,
+ * so creating a room only takes a game out of the pool and generates its key. When the pool drops
+ * below 'game_pool_low' games, it's refilled up to 'game_pool_high' in the background; stopped games
+ * are reset and put back into the pool (instead of being freed), as long as it has less than
+ * 'game_pool_high' games.
+ *
+ * @return whether the pool was started
+ */
+bool game_pool_start() {
+	SDL_LOCK_MUTEX(pool_mutex);
+	if (pool_cond == NULL)
+		pool_cond = SDL_CreateCond();
+	if (pool_cond == NULL)
+		SDL_ERROR("SDL_CreateCond()", goto error);
+	if (SETTINGS->game_pool_high <= 0)
+		goto error;
+	pool_running = true;
+	SDL_UNLOCK_MUTEX(pool_mutex);
+
+	// fill the pool upfront, so that the first rooms don't wait
+	while ((int)pool_count < SETTINGS->game_pool_high) {
+		game_t *game = game_create(NULL);
+		if (game == NULL)
+			return false;
+		SDL_WITH_MUTEX(pool_mutex) {
+			DL_APPEND(pool_list, game);
+			pool_count++;
+		}
+	}
+
+	SDL_Thread *thread = SDL_CreateThread(game_pool_thread, "pool", NULL);
+	if (thread == NULL)
+		SDL_ERROR("SDL_CreateThread()", return false);
+	SDL_DetachThread(thread);
+	LT_I("Pool: started with %u games", pool_count);
+	return true;
+
+error:
+	SDL_UNLOCK_MUTEX(pool_mutex);
+	return false;
+}
+
+/**
+ * Server: take an idle game out of the pool and make it joinable.
+ * A new game is created if the pool is empty (or not started).
+ *
+ * @return the game, NULL on error
+ */
+game_t *game_pool_claim() {
+	game_t *game = NULL;
+	SDL_WITH_MUTEX(pool_mutex) {
+		if (pool_list == NULL)
+			continue;
+		game = pool_list;
+		DL_DELETE(pool_list, game);
+		pool_count--;
+		if ((int)pool_count < SETTINGS->game_pool_low)
+			SDL_CondSignal(pool_cond);
+	}
+	if (game == NULL) {
+		LT_W("Pool: empty, creating a new game");
+		return game_init(NULL);
+	}
+	game_activate(game);
+	return game;
+}
+
+/**
+ * Server: reset a stopped game and put it back into the pool, if it's not full.
+ * Must be called by the game thread.
+ *
+ * @return whether the game was recycled; if not, it should be freed
+ */
+bool game_pool_recycle(game_t *game) {
+	bool recycle = false;
+	SDL_WITH_MUTEX(pool_mutex) {
+		recycle = pool_running && (int)pool_count < SETTINGS->game_pool_high;
+	}
+	if (!recycle)
+		return false;
+
+	game_reset(game);
+	SDL_WITH_MUTEX(pool_mutex) {
+		DL_APPEND(pool_list, game);
+		pool_count++;
+	}
+	LT_I("Game: recycled into the pool");
+	return true;
+}
+
+/**
+ * Server: stop all idle games and the refill thread.
+ */
+void game_pool_stop() {
+	game_t *list = NULL;
+	SDL_WITH_MUTEX(pool_mutex) {
+		pool_running = false;
+		list		 = pool_list;
+		pool_list	 = NULL;
+		pool_count	 = 0;
+		SDL_CondSignal(pool_cond);
+	}
+	game_t *game, *tmp;
+	DL_FOREACH_SAFE(list, game, tmp) {
+		DL_DELETE(list, game);
+		SDL_WITH_MUTEX(game->mutex) {
+			game_stop(game);
+		}
+	}
+}
+
+static int game_pool_thread(void *param) {
+	lt_log_set_thread_name("pool");
+
+	SDL_LOCK_MUTEX(pool_mutex);
+	while (pool_running) {
+		if ((int)pool_count >= SETTINGS->game_pool_low) {
+			SDL_CondWait(pool_cond, pool_mutex);
+			continue;
+		}
+		// refill up to the high watermark, without blocking the claims
+		while (pool_running && (int)pool_count < SETTINGS->game_pool_high) {
+			SDL_UNLOCK_MUTEX(pool_mutex);
+			game_t *game = game_create(NULL);
+			SDL_LOCK_MUTEX(pool_mutex);
+			if (game == NULL)
+				break;
+			if (!pool_running) {
+				// stopped in the meantime
+				game_stop(game);
+				break;
+			}
+			DL_APPEND(pool_list, game);
+			pool_count++;
+		}
+		LT_D("Pool: refilled to %u games", pool_count);
+		if ((int)pool_count < SETTINGS->game_pool_low)
+			// creating games failed, try again later
+			SDL_CondWaitTimeout(pool_cond, pool_mutex, 1000);
+	}
+	SDL_UNLOCK_MUTEX(pool_mutex);
+	return 0;
+}
@@ -0,0 +1,349 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-9.
+
+#include "game.h"
+
+// IDs of the relay's own spectators; the mirrored players use 10..99
+// (the spectators never take part in the match, so they don't need to fit in spectator frames)
+#define RELAY_PLAYER_ID_MIN 100
+#define RELAY_PLAYER_ID_MAX 65535
+
+static bool relay_process_upstream(game_t *game, pkt_t *pkt, net_endpoint_t *source);
+static bool relay_process_downstream(game_t *game, pkt_t *pkt, net_endpoint_t *source);
+static void relay_send_join_data(game_t *game, net_endpoint_t *join_endpoint);
+static bool relay_next_player_id(game_t *game, unsigned int *id);
+
+/**
+ * Start a relay of a game hosted on another server.
+ *
+ * The relay joins the upstream game once, as a read-only spectator, and mirrors its state -
+ * the game data, the players and the spectator stream. Its own clients join the relay under
+ * the same key and can only spectate; the upstream server only sends the stream to the relay,
+ * regardless of how many spectators are connected to it. Relays can be chained.
+ *
+ * @param address upstream server address (host[:port])
+ * @param key key of the game to relay
+ * @return the mirrored game, NULL on error
+ */
+game_t *game_relay_start(const char *address, const char *key) {
+	net_endpoint_t endpoint = {
+		.type = NET_ENDPOINT_TLS,
+	};
+	game_t *game = NULL;
+	net_err_t err;
+
+	// check port number if specified
+	char host[256];
+	int port = SETTINGS->server_port;
+	strncpy2(host, address, sizeof(host) - 1);
+	char *port_str = strchr(host, ':');
+	if (port_str != NULL) {
+		*port_str = '\0';
+		port	  = atoi(port_str + 1);
+	}
+
+	// connect to the upstream server
+	endpoint.addr.sin_family = AF_INET;
+	endpoint.addr.sin_port	 = htons(port);
+	if (!net_resolve_ip(host, &endpoint.addr.sin_addr))
+		LT_ERR(E, return NULL, "Relay: couldn't resolve '%s'", host);
+	if (net_endpoint_connect(&endpoint) != NET_ERR_OK)
+		LT_ERR(E, return NULL, "Relay: couldn't connect to %s:%d", host, port);
+	LT_I("Relay: connected to %s", net_endpoint_str(&endpoint));
+
+	// join the game
+	pkt_game_join_t pkt_join = {
+		.hdr.type = PKT_GAME_JOIN,
+	};
+	strncpy2(pkt_join.key, key, GAME_KEY_LEN);
+	if (net_pkt_send(&endpoint, (pkt_t *)&pkt_join) != NET_ERR_OK)
+		goto cleanup;
+
+	// wait for the game data
+	pkt_t *pkt = &endpoint.recv.pkt;
+	while (true) {
+		if ((err = net_pkt_recv(&endpoint)) < NET_ERR_OK)
+			goto cleanup;
+		if (err != NET_ERR_OK_PACKET)
+			continue;
+		if (pkt->hdr.type == PKT_ERROR) {
+			game_print_error(pkt->error.error);
+			goto cleanup;
+		}
+		if (pkt->hdr.type == PKT_GAME_DATA && !pkt->game_data.is_list)
+			break;
+	}
+
+	// join as a spectator, before the game thread takes over the endpoint
+	pkt_player_new_t pkt_new = {
+		.hdr.type	  = PKT_PLAYER_NEW,
+		.is_spectator = true,
+	};
+	strncpy2(pkt_new.name, "Relay", PLAYER_NAME_LEN);
+	if (net_pkt_send(&endpoint, (pkt_t *)&pkt_new) != NET_ERR_OK)
+		goto cleanup;
+
+	game = game_init(NULL);
+	if (game == NULL)
+		goto cleanup;
+	net_endpoint_t *item = net_endpoint_dup(&endpoint, game->arena);
+	if (item == NULL)
+		goto cleanup_game;
+
+	SDL_WITH_MUTEX(game->mutex) {
+		// use the upstream game's key, so that clients can join the relay with it
+		memcpy(game->key, pkt->game_data.key, sizeof(game->key));
+		memcpy(game->name, pkt->game_data.name, sizeof(game->name));
+		game->is_public = pkt->game_data.is_public;
+		game->speed		= pkt->game_data.speed;
+		game->state		= pkt->game_data.state;
+		game->round		= pkt->game_data.round;
+		game->rounds	= pkt->game_data.rounds;
+		// add the upstream endpoint (without sending the join data to it)
+		game->upstream = item;
+		DL_APPEND(game->endpoints, item);
+		// the relay lives as long as the upstream game
+		SDL_RemoveTimer(game->expiry_timer);
+		game->expiry_timer = 0;
+		// wake up the game thread to include the new endpoint
+		pkt_ping_t pkt_ping = {
+			.hdr.type = PKT_PING,
+		};
+		net_pkt_send_pipe(game->endpoints, (pkt_t *)&pkt_ping);
+	}
+	SDL_DestroyMutex(endpoint.mutex);
+
+	LT_I("Relay: mirroring '%s' (key: %s)", game->name, game->key);
+	return game;
+
+cleanup_game:
+	game_stop(game);
+cleanup:
+	LT_E("Relay: couldn't join the upstream game '%s'", key);
+	net_endpoint_free(&endpoint);
+	SDL_DestroyMutex(endpoint.mutex);
+	return NULL;
+}
+
+/**
+ * Process a packet of a relay game. Packets from the upstream server update the mirrored state
+ * and are forwarded to the relay's clients; the clients can only join as spectators.
+ *
+ * @param broadcast whether the packet should be broadcast to other endpoints (if handled)
+ * @return whether the packet was handled; if not, it should be processed as usual
+ */
+bool game_relay_process_packet(game_t *game, pkt_t *pkt, net_endpoint_t *source, bool *broadcast) {
+	*broadcast = false;
+	if (pkt->hdr.type == PKT_PING)
+		// answer the pings as usual
+		return false;
+	if (source == NULL || source->type == NET_ENDPOINT_PIPE) {
+		if (pkt->hdr.type != PKT_REQUEST_SEND_DATA)
+			return false;
+		// endpoint joined - only send the mirrored game and players
+		// (updates of the relay's own spectators are never sent, especially not upstream)
+		if (pkt->request_send_data.join_endpoint != 0)
+			relay_send_join_data(game, (void *)pkt->request_send_data.join_endpoint);
+		return true;
+	}
+	if (source == game->upstream)
+		*broadcast = relay_process_upstream(game, pkt, source);
+	else
+		*broadcast = relay_process_downstream(game, pkt, source);
+	return true;
+}
+
+static bool relay_process_upstream(game_t *game, pkt_t *pkt, net_endpoint_t *source) {
+	player_t *player, *tmp;
+	switch (pkt->hdr.type) {
+		case PKT_ERROR:
+			game_print_error(pkt->error.error);
+			return false;
+
+		case PKT_GAME_DATA:
+			game->is_public = pkt->game_data.is_public;
+			game->speed		= pkt->game_data.speed;
+			game->state		= pkt->game_data.state;
+			game->round		= pkt->game_data.round;
+			game->rounds	= pkt->game_data.rounds;
+			if (pkt->game_data.name[0] != '\0')
+				memcpy(game->name, pkt->game_data.name, sizeof(game->name));
+			return true;
+
+		case PKT_GAME_START:
+			game->state = GAME_STARTING;
+			return true;
+
+		case PKT_GAME_STOP:
+			game->state = GAME_IDLE;
+			DL_FOREACH_SAFE(game->players, player, tmp) {
+				if (player->endpoint != NULL)
+					// relay's own spectator
+					continue;
+				if (player->state == PLAYER_DISCONNECTED) {
+					DL_DELETE(game->players, player);
+					player_free(player);
+					continue;
+				}
+				if (player->state != PLAYER_SPECTATING)
+					player->state = PLAYER_IDLE;
+				player->is_in_round = false;
+			}
+			return true;
+
+		case PKT_GAME_START_ROUND: {
+			// send to all clients, while adjusting their 'count_at' and 'start_at' timestamps
+			unsigned long long count_at = pkt->game_start_round.count_at;
+			unsigned long long start_at = pkt->game_start_round.start_at;
+			net_endpoint_t *endpoint;
+			DL_FOREACH(game->endpoints, endpoint) {
+				if (endpoint == source)
+					continue;
+				pkt->game_start_round.count_at = count_at - endpoint->time_delta - endpoint->ping_rtt / 2;
+				pkt->game_start_round.start_at = start_at - endpoint->time_delta - endpoint->ping_rtt / 2;
+				net_pkt_send(endpoint, pkt);
+			}
+			return false;
+		}
+
+		case PKT_PLAYER_DATA:
+			player = game_get_player_by_id(game, pkt->player_data.id);
+			if (player == NULL) {
+				player = player_init(game, pkt->player_data.name);
+				if (player == NULL)
+					return false;
+				DL_APPEND(game->players, player);
+			}
+			player->id	  = pkt->player_data.id;
+			player->color = pkt->player_data.color;
+			player->state = pkt->player_data.state;
+			if (pkt->player_data.name[0] != '\0')
+				memcpy(player->name, pkt->player_data.name, sizeof(player->name));
+			PLAYER_POS(player, 0)->lap = pkt->player_data.lap;
+			// the relay's own player is not local to its clients
+			pkt->player_data.is_local = false;
+			return true;
+
+		case PKT_PLAYER_LEAVE:
+			player = game_get_player_by_id(game, pkt->player_leave.id);
+			if (player != NULL && player->endpoint == NULL) {
+				DL_DELETE(game->players, player);
+				player_free(player);
+			}
+			return true;
+
+		case PKT_SPECTATE_FRAME: {
+			if (!match_spectate_apply(game, &pkt->spectate_frame))
+				return false;
+			// send to all spectators' endpoints
+			net_endpoint_t *endpoint;
+			DL_FOREACH(game->endpoints, endpoint) {
+				if (endpoint->spectators != 0)
+					net_pkt_send(endpoint, pkt);
+			}
+			return false;
+		}
+
+		default:
+			// the relay doesn't take part in the match
+			return false;
+	}
+}
+
+static bool relay_process_downstream(game_t *game, pkt_t *pkt, net_endpoint_t *source) {
+	player_t *player;
+	switch (pkt->hdr.type) {
+		case PKT_PLAYER_NEW: {
+			unsigned int id;
+			if (!relay_next_player_id(game, &id)) {
+				LT_W("Relay: no more spectator IDs available, rejecting '%s'", pkt->player_new.name);
+				game_send_error(game, source, GAME_ERR_FULL);
+				return false;
+			}
+			player = player_init(game, pkt->player_new.name);
+			if (player == NULL) {
+				game_send_error(game, source, GAME_ERR_SERVER_ERROR);
+				return false;
+			}
+			player->id			 = id;
+			player->state		 = PLAYER_SPECTATING;
+			player->is_spectator = true;
+			player->endpoint	 = source;
+			LT_I("Relay: adding spectator #%d '%s'", player->id, player->name);
+			DL_APPEND(game->players, player);
+			source->spectators++;
+
+			// the spectator is only visible to its own endpoint
+			pkt_player_data_t pkt_data = {
+				.hdr.type = PKT_PLAYER_DATA,
+				.is_local = true,
+			};
+			player_fill_data_pkt(game, player, &pkt_data);
+			net_pkt_send(source, (pkt_t *)&pkt_data);
+
+			// sync the spectator's time, for the round start timestamps
+			source->ping_time = millis();
+			pkt_ping_t pkt_ping = {
+				.hdr.type  = PKT_PING,
+				.send_time = source->ping_time,
+			};
+			net_pkt_send(source, (pkt_t *)&pkt_ping);
+
+			if (game->state != GAME_IDLE)
+				// stream a keyframe of the last received frame
+				match_spectate_keyframe(game, game->spectate_tick, source);
+			return false;
+		}
+
+		case PKT_PLAYER_LEAVE:
+			player = game_get_player_by_id(game, pkt->player_leave.id);
+			if (player != NULL && player->endpoint == source)
+				game_del_player(game, player);
+			return false;
+
+		default:
+			// the relay's clients are read-only
+			return false;
+	}
+}
+
+static void relay_send_join_data(game_t *game, net_endpoint_t *join_endpoint) {
+	pkt_game_data_t pkt = {
+		.hdr.type = PKT_GAME_DATA,
+		.is_list  = false,
+	};
+	game_fill_data_pkt(game, &pkt);
+	net_pkt_send(join_endpoint, (pkt_t *)&pkt);
+
+	player_t *player;
+	DL_FOREACH(game->players, player) {
+		if (player->endpoint != NULL)
+			// other relay's spectators are not visible
+			continue;
+		pkt_player_data_t pkt = {
+			.hdr.type = PKT_PLAYER_DATA,
+		};
+		player_fill_data_pkt(game, player, &pkt);
+		net_pkt_send(join_endpoint, (pkt_t *)&pkt);
+	}
+}
+
+/**
+ * Allocate an ID for the relay's own spectator, in the RELAY_PLAYER_ID_MIN..RELAY_PLAYER_ID_MAX range.
+ * IDs are assigned sequentially (wrapping around), skipping the ones still in use.
+ *
+ * @return false if all IDs are in use
+ */
+static bool relay_next_player_id(game_t *game, unsigned int *id) {
+	player_t *player;
+	unsigned int count = 0;
+	DL_COUNT(game->players, player, count);
+	// at least one ID in the range is free if there are fewer players than IDs
+	if (count > RELAY_PLAYER_ID_MAX - RELAY_PLAYER_ID_MIN)
+		return false;
+	do {
+		if (game->relay_next_id < RELAY_PLAYER_ID_MIN || game->relay_next_id > RELAY_PLAYER_ID_MAX)
+			game->relay_next_id = RELAY_PLAYER_ID_MIN;
+		*id = game->relay_next_id++;
+	} while (game_get_player_by_id(game, *id) != NULL);
+	return true;
+}
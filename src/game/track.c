@@ -0,0 +1,243 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-10.
+
+#include "track.h"
+
+#include "track_res.h"
+
+static bool track_read_numbers(cJSON *json, double *values, int count);
+static bool track_read_shape(cJSON *json, track_shape_t *shape);
+static bool track_read_gate(cJSON *json, track_gate_t *gate);
+static bool track_shape_contains(const track_shape_t *shape, double x, double y, double grow);
+static double track_gate_distance(const track_gate_t *gate, double x, double y);
+static void track_build_grid(track_t *track);
+
+/**
+ * Load a track description, build its collision grid and make it the current track.
+ *
+ * The track surface is a union of rectangles and ring sectors; the finish and half-lap
+ * lines are gate segments. All shapes are only evaluated once, when building the grid -
+ * the simulation then only looks up the grid and checks the swept gate crossings.
+ *
+ * @param file track description file, NULL or empty to load the built-in track
+ * @return whether the track was loaded
+ */
+bool track_load(const char *file) {
+	cJSON *json;
+	if (file != NULL && file[0] != '\0') {
+		json = file_read_json(file);
+	} else {
+		file = "(built-in)";
+		json = cJSON_Parse((const char *)TRACK_CLASSIC_JSON);
+	}
+	if (json == NULL)
+		LT_ERR(E, return false, "Track: couldn't read '%s'", file);
+
+	track_t *track;
+	MALLOC(track, sizeof(*track), goto error);
+
+	// read the board
+	char *name = NULL;
+	json_read_string(json, "name", &name);
+	if (name != NULL)
+		strncpy2(track->name, name, TRACK_NAME_LEN);
+	free(name);
+	track->width  = 640;
+	track->height = 480;
+	track->wall	  = 5;
+	json_read_uint(json, "width", &track->width);
+	json_read_uint(json, "height", &track->height);
+	json_read_uint(json, "wall", &track->wall);
+	double start[2];
+	if (!track_read_numbers(cJSON_GetObjectItem(json, "start"), start, 2))
+		LT_ERR(E, goto error, "Track: 'start' is invalid");
+	track->start_x = start[0];
+	track->start_y = start[1];
+
+	// read the surface shapes
+	cJSON *shapes	  = cJSON_GetObjectItem(json, "surface");
+	track->shapes_num = cJSON_GetArraySize(shapes);
+	if (track->shapes_num == 0)
+		LT_ERR(E, goto error, "Track: 'surface' is empty");
+	MALLOC(track->shapes, sizeof(*track->shapes) * track->shapes_num, goto error);
+	unsigned int i = 0;
+	cJSON *item;
+	cJSON_ArrayForEach(item, shapes) {
+		if (!track_read_shape(item, &track->shapes[i++]))
+			LT_ERR(E, goto error, "Track: surface shape #%u is invalid", i - 1);
+	}
+
+	// read the gates
+	if (!track_read_gate(cJSON_GetObjectItem(json, "finish"), &track->finish))
+		LT_ERR(E, goto error, "Track: 'finish' is invalid");
+	if (!track_read_gate(cJSON_GetObjectItem(json, "half_lap"), &track->half_lap))
+		LT_ERR(E, goto error, "Track: 'half_lap' is invalid");
+	cJSON *lines	 = cJSON_GetObjectItem(json, "lines");
+	track->lines_num = cJSON_GetArraySize(lines);
+	if (track->lines_num != 0) {
+		MALLOC(track->lines, sizeof(*track->lines) * track->lines_num, goto error);
+		i = 0;
+		cJSON_ArrayForEach(item, lines) {
+			if (!track_read_gate(item, &track->lines[i++]))
+				LT_ERR(E, goto error, "Track: line #%u is invalid", i - 1);
+		}
+	}
+
+	// precompute the collision grid
+	track->grid_w = track->width * TRACK_GRID_SCALE;
+	track->grid_h = track->height * TRACK_GRID_SCALE;
+	MALLOC(track->grid, track->grid_w * track->grid_h, goto error);
+	track_build_grid(track);
+
+	LT_I("Track: loaded '%s' from %s (%u shapes)", track->name, file, track->shapes_num);
+	cJSON_Delete(json);
+	track_free(TRACK);
+	TRACK = track;
+	return true;
+
+error:
+	cJSON_Delete(json);
+	track_free(track);
+	return false;
+}
+
+void track_free(track_t *track) {
+	if (track == NULL)
+		return;
+	free(track->shapes);
+	free(track->lines);
+	free(track->grid);
+	free(track);
+}
+
+/**
+ * Check whether a movement from 'prev' to 'next' crosses the gate in the forward direction,
+ * i.e. with the gate's end point on the right-hand side of the player.
+ */
+bool track_gate_crossed(const track_gate_t *gate, double prev_x, double prev_y, double next_x, double next_y) {
+	double ex = gate->x2 - gate->x1;
+	double ey = gate->y2 - gate->y1;
+	// which side of the gate's line both points are on
+	double side_prev = ex * (prev_y - gate->y1) - ey * (prev_x - gate->x1);
+	double side_next = ex * (next_y - gate->y1) - ey * (next_x - gate->x1);
+	if (!(side_prev >= 0.0 && side_next < 0.0))
+		return false;
+	// check if the line is crossed within the gate segment
+	double t = side_prev / (side_prev - side_next);
+	double x = prev_x + (next_x - prev_x) * t;
+	double y = prev_y + (next_y - prev_y) * t;
+	double u = ((x - gate->x1) * ex + (y - gate->y1) * ey) / (ex * ex + ey * ey);
+	return u >= 0.0 && u <= 1.0;
+}
+
+static bool track_read_shape(cJSON *json, track_shape_t *shape) {
+	char *type = NULL;
+	json_read_string(json, "type", &type);
+	if (type == NULL)
+		return false;
+	bool ret = true;
+	if (strcmp(type, "rect") == 0) {
+		shape->type = TRACK_SHAPE_RECT;
+		json_read_double(json, "x1", &shape->x1);
+		json_read_double(json, "y1", &shape->y1);
+		json_read_double(json, "x2", &shape->x2);
+		json_read_double(json, "y2", &shape->y2);
+		ret = shape->x1 < shape->x2 && shape->y1 < shape->y2;
+	} else if (strcmp(type, "arc") == 0) {
+		shape->type = TRACK_SHAPE_ARC;
+		shape->from = 0;
+		shape->to	= 360;
+		json_read_double(json, "x", &shape->x1);
+		json_read_double(json, "y", &shape->y1);
+		json_read_double(json, "r1", &shape->r1);
+		json_read_double(json, "r2", &shape->r2);
+		json_read_int(json, "from", &shape->from);
+		json_read_int(json, "to", &shape->to);
+		ret = shape->r1 < shape->r2 && shape->from < shape->to && shape->to - shape->from <= 360;
+	} else {
+		ret = false;
+	}
+	free(type);
+	return ret;
+}
+
+static bool track_read_numbers(cJSON *json, double *values, int count) {
+	if (cJSON_GetArraySize(json) != count)
+		return false;
+	for (int i = 0; i < count; i++) {
+		cJSON *item = cJSON_GetArrayItem(json, i);
+		if (!cJSON_IsNumber(item))
+			return false;
+		values[i] = item->valuedouble;
+	}
+	return true;
+}
+
+static bool track_read_gate(cJSON *json, track_gate_t *gate) {
+	double values[4];
+	if (!track_read_numbers(json, values, 4))
+		return false;
+	gate->x1 = values[0];
+	gate->y1 = values[1];
+	gate->x2 = values[2];
+	gate->y2 = values[3];
+	return gate->x1 != gate->x2 || gate->y1 != gate->y2;
+}
+
+/**
+ * Check whether the point is inside the shape, grown by 'grow' pixels in every direction.
+ * The shape's edges are not part of it.
+ */
+static bool track_shape_contains(const track_shape_t *shape, double x, double y, double grow) {
+	if (shape->type == TRACK_SHAPE_RECT)
+		return x > shape->x1 - grow && x < shape->x2 + grow && y > shape->y1 - grow && y < shape->y2 + grow;
+	double dx	= x - shape->x1;
+	double dy	= shape->y1 - y;
+	double dist = sqrt(dx * dx + dy * dy);
+	if (dist <= shape->r1 - grow || dist >= shape->r2 + grow)
+		return false;
+	double angle = atan2(dy, dx) * 180.0 / M_PI;
+	// make the angle relative to the sector's start, 0..360
+	angle = fmod(angle - shape->from + 720.0, 360.0);
+	return angle <= shape->to - shape->from;
+}
+
+static double track_gate_distance(const track_gate_t *gate, double x, double y) {
+	double ex = gate->x2 - gate->x1;
+	double ey = gate->y2 - gate->y1;
+	double u  = ((x - gate->x1) * ex + (y - gate->y1) * ey) / (ex * ex + ey * ey);
+	u		  = min(max(u, 0.0), 1.0);
+	double dx = x - (gate->x1 + ex * u);
+	double dy = y - (gate->y1 + ey * u);
+	return sqrt(dx * dx + dy * dy);
+}
+
+/**
+ * Classify every cell of the grid, sampling the shapes at the cell's center.
+ */
+static void track_build_grid(track_t *track) {
+	for (unsigned int gy = 0; gy < track->grid_h; gy++) {
+		double y = (gy + 0.5) / TRACK_GRID_SCALE;
+		for (unsigned int gx = 0; gx < track->grid_w; gx++) {
+			double x	 = (gx + 0.5) / TRACK_GRID_SCALE;
+			uint8_t cell = 0;
+			bool is_wall = false;
+			for (unsigned int i = 0; i < track->shapes_num; i++) {
+				if (track_shape_contains(&track->shapes[i], x, y, 0.0)) {
+					cell |= TRACK_CELL_SURFACE;
+					break;
+				}
+				if (!is_wall)
+					is_wall = track_shape_contains(&track->shapes[i], x, y, track->wall);
+			}
+			if (is_wall && (cell & TRACK_CELL_SURFACE) == 0)
+				cell |= TRACK_CELL_WALL;
+			// the gates can only be crossed by a step ending this close to them
+			if (track_gate_distance(&track->finish, x, y) <= TRACK_GATE_MARGIN ||
+				track_gate_distance(&track->half_lap, x, y) <= TRACK_GATE_MARGIN)
+				cell |= TRACK_CELL_GATE;
+			track->grid[gy * track->grid_w + gx] = cell;
+		}
+	}
+}
+
+track_t *TRACK = NULL;
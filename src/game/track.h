@@ -0,0 +1,69 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-10.
+
+#pragma once
+
+#include "include.h"
+
+// collision grid cell flags
+#define TRACK_CELL_SURFACE (1 << 0) //!< Cell is on the track surface (drivable)
+#define TRACK_CELL_WALL	   (1 << 1) //!< Cell is on the wall drawn around the surface
+#define TRACK_CELL_GATE	   (1 << 2) //!< Cell is close to the finish or half-lap gate
+
+typedef enum track_shape_type_t {
+	TRACK_SHAPE_RECT = 0, //!< Axis-aligned rectangle
+	TRACK_SHAPE_ARC	 = 1, //!< Ring sector
+} track_shape_type_t;
+
+typedef struct track_shape_t {
+	track_shape_type_t type; //!< Shape type
+	double x1, y1;			 //!< Top-left corner (rect) or center (arc)
+	double x2, y2;			 //!< Bottom-right corner (rect)
+	double r1, r2;			 //!< Inner and outer radius (arc)
+	int from, to;			 //!< Angle range, counter-clockwise (0: right, 90: up) (arc)
+} track_shape_t;
+
+typedef struct track_gate_t {
+	double x1, y1; //!< Gate start point
+	double x2, y2; //!< Gate end point
+} track_gate_t;
+
+typedef struct track_t {
+	char name[TRACK_NAME_LEN + 1]; //!< Track name
+	unsigned int width;			   //!< Board width (px)
+	unsigned int height;		   //!< Board height (px)
+	unsigned int wall;			   //!< Thickness of the wall drawn around the surface (px)
+	double start_x;				   //!< Starting position X
+	double start_y;				   //!< First starting position Y (the grid extends 60 px downwards)
+
+	track_shape_t *shapes;	 //!< Shapes forming the track surface
+	unsigned int shapes_num; //!< Number of surface shapes
+	track_gate_t finish;	 //!< Finish line gate
+	track_gate_t half_lap;	 //!< Half-lap gate, must be passed before finishing a lap
+	track_gate_t *lines;	 //!< Starting gate lines (drawn before the round starts)
+	unsigned int lines_num;	 //!< Number of starting gate lines
+
+	uint8_t *grid;		 //!< Collision grid, TRACK_GRID_SCALE cells per pixel (TRACK_CELL_* flags)
+	unsigned int grid_w; //!< Collision grid width (cells)
+	unsigned int grid_h; //!< Collision grid height (cells)
+} track_t;
+
+extern track_t *TRACK;
+
+/**
+ * Get the collision grid flags of the cell containing the specified point.
+ * Points outside the board are neither surface nor wall.
+ */
+static inline unsigned int track_get_cell(const track_t *track, double x, double y) {
+	if (x < 0.0 || y < 0.0)
+		return 0;
+	unsigned int gx = (unsigned int)(x * TRACK_GRID_SCALE);
+	unsigned int gy = (unsigned int)(y * TRACK_GRID_SCALE);
+	if (gx >= track->grid_w || gy >= track->grid_h)
+		return 0;
+	return track->grid[gy * track->grid_w + gx];
+}
+
+// track.c
+bool track_load(const char *file);
+bool track_gate_crossed(const track_gate_t *gate, double prev_x, double prev_y, double next_x, double next_y);
+void track_free(track_t *track);
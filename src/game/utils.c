@@ -16,6 +16,12 @@ void game_print_error(game_err_t error) {
 		case GAME_ERR_NO_PLAYER:
 			LT_E("Player not found by the specified ID");
 			break;
+		case GAME_ERR_FULL:
+			LT_E("No more players can join the game");
+			break;
+		case GAME_ERR_RESTARTING:
+			LT_E("Server is restarting, try again");
+			break;
 		case GAME_ERR_SERVER_ERROR:
 			LT_E("Internal server error");
 			break;
@@ -35,6 +41,8 @@ bool game_send_error(game_t *game, net_endpoint_t *endpoint, game_err_t error) {
 }
 
 void game_stop_all() {
+	// stop the idle games first, so that the stopped games aren't recycled
+	game_pool_stop();
 	SDL_mutex *game_list_mutex;
 	game_t *game_list = game_get_list(&game_list_mutex);
 	if (game_list == NULL)
@@ -16,7 +16,9 @@
 
 #include <SDL2/SDL.h>
 #include <cJSON.h>
+#include <openssl/crypto.h>
 #include <openssl/err.h>
+#include <openssl/hmac.h>
 #include <openssl/ssl.h>
 #include <utlist.h>
 
@@ -30,21 +32,26 @@
 #include <ifaddrs.h>
 #include <netdb.h>
 #include <poll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
 #include "core/config.h"
 
+#include "core/arena.h"
 #include "core/errmacros.h"
 #include "core/logger.h"
 #include "core/settings.h"
 #include "core/utils.h"
 #include "core/version.h"
+#include "core/wakeup.h"
 
 #include "game/game.h"
 #include "game/match/match.h"
 #include "game/player/player.h"
+#include "game/track.h"
 #include "net/net.h"
 
 #include "ui/fragment/fragment.h"
@@ -20,6 +20,16 @@ int main(int argc, char *argv[]) {
 
 	version_print();
 	settings_load();
+	player_trig_init();
+	if (!track_load(SETTINGS->track_file))
+		return 1;
+
+	// run a headless simulation instead of the server
+	if (argc >= 3 && strcmp(argv[1], "--sim") == 0)
+		return match_sim_run(argv[2]) ? 0 : 1;
+	// print a replay file's summary
+	if (argc >= 3 && strcmp(argv[1], "--replay") == 0)
+		return match_replay_dump(argv[2], argc >= 4 ? (int)strtol(argv[3], NULL, 0) : -1) ? 0 : 1;
 
 	// load certificate
 	char *cert = file_read_data(SETTINGS->tls_cert_file);
@@ -44,11 +54,29 @@ int main(int argc, char *argv[]) {
 	if (port != NULL)
 		SETTINGS->server_port = strtol(port + 1, NULL, 0);
 
-	for (int i = 0; i < 8; i++) {
-		game_t *game	= game_init(NULL);
-		game->is_public = i % 2 == 0;
+	if (argc >= 4 && strcmp(argv[1], "--relay") == 0) {
+		// mirror a game of another server for spectators
+		if (game_relay_start(argv[2], argv[3]) == NULL)
+			return 1;
+	} else if (argc >= 2 && strcmp(argv[1], "--directory") == 0) {
+		// only keep track of the cluster's nodes, without hosting games
+		net_cluster_directory_start();
+	} else {
+		// host a shard of the cluster's games
+		if (argc >= 4 && strcmp(argv[1], "--cluster") == 0 &&
+			!net_cluster_node_start(argv[2], (int)strtol(argv[3], NULL, 0), argc >= 5 ? argv[4] : NULL))
+			return 1;
+		// keep idle games ready for new rooms
+		game_pool_start();
+		for (int i = 0; i < 8; i++) {
+			game_t *game = game_pool_claim();
+			if (game != NULL)
+				game->is_public = i % 2 == 0;
+		}
 	}
 
 	net_server_start(true);
+	// finish writing the replays of the last rounds
+	match_replay_wait();
 	return 0;
 }
@@ -9,6 +9,9 @@ int main(int argc, char *argv[]) {
 
 	version_print();
 	settings_load();
+	player_trig_init();
+	if (!track_load(SETTINGS->track_file))
+		return 1;
 
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 		SDL_ERROR("SDL_Init()", return 1);
@@ -32,7 +35,8 @@ int main(int argc, char *argv[]) {
 	if (window == NULL)
 		SDL_ERROR("SDL_CreateWindow()", ret = 2; goto quit);
 
-	SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+	Uint32 flags		   = SDL_RENDERER_ACCELERATED | (SETTINGS->vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+	SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, flags);
 	if (renderer == NULL)
 		SDL_ERROR("SDL_CreateRenderer()", ret = 3; goto free_window);
 	SDL_RenderSetScale(renderer, (float)SETTINGS->screen.scale, (float)SETTINGS->screen.scale);
@@ -5,6 +5,7 @@
 static int net_client_connect(char *address);
 static net_err_t net_client_select_read_cb(net_endpoint_t *endpoint, net_t *net);
 static void net_client_select_err_cb(net_endpoint_t *endpoint, net_t *net, net_err_t err);
+static net_err_t net_client_redirect(net_t *net, const char *address);
 
 static net_t *client = NULL;
 
@@ -169,6 +170,17 @@ static net_err_t net_client_select_read_cb(net_endpoint_t *endpoint, net_t *net)
 		return NET_ERR_OK;
 	}
 
+	if (pkt->hdr.type == PKT_REDIRECT && endpoint == &net->endpoint)
+		// cluster: the request must be sent to another server
+		return net_client_redirect(net, pkt->redirect.address);
+	if (endpoint == &net->endpoint)
+		// the server answered the request, allow redirecting the next ones
+		net->redirects = 0;
+	if (endpoint != &net->endpoint &&
+		(pkt->hdr.type == PKT_GAME_LIST || pkt->hdr.type == PKT_GAME_NEW || pkt->hdr.type == PKT_GAME_JOIN))
+		// remember the request, in case it's redirected
+		memcpy(&net->request, pkt, pkt->hdr.len);
+
 	return net_pkt_broadcast(&net->endpoint, pkt, endpoint);
 }
 
@@ -181,3 +193,39 @@ static void net_client_select_err_cb(net_endpoint_t *endpoint, net_t *net, net_e
 		LT_E("Client: connection error from %s", net_endpoint_str(endpoint));
 	net->stop = true;
 }
+
+/**
+ * Reconnect to another server of the cluster, and repeat the last request there.
+ */
+static net_err_t net_client_redirect(net_t *net, const char *address) {
+	if (++net->redirects > 3)
+		LT_ERR(E, return NET_ERR_CONNECT, "Client: too many redirects");
+	if (net->request.hdr.type == 0)
+		LT_ERR(E, return NET_ERR_CONNECT, "Client: redirected without a request");
+
+	// check port number if specified
+	char host[CLUSTER_ADDRESS_LEN + 1];
+	int port = SETTINGS->server_port;
+	strncpy2(host, address, CLUSTER_ADDRESS_LEN);
+	char *port_str = strchr(host, ':');
+	if (port_str != NULL) {
+		*port_str = '\0';
+		port	  = atoi(port_str + 1);
+	}
+	struct sockaddr_in saddr = {
+		.sin_family = AF_INET,
+		.sin_port	= htons(port),
+	};
+	if (!net_resolve_ip(host, &saddr.sin_addr))
+		return NET_ERR_CONNECT;
+
+	// reconnect, keeping the endpoint linked with the pipe
+	LT_I("Client: redirected to %s", address);
+	net_endpoint_free(&net->endpoint);
+	net->endpoint.addr	   = saddr;
+	net->endpoint.recv.buf = NULL;
+	net_err_t err		   = net_endpoint_connect(&net->endpoint);
+	if (err != NET_ERR_OK)
+		return err;
+	return net_pkt_send(&net->endpoint, &net->request);
+}
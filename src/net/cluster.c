@@ -0,0 +1,497 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-12.
+
+#include "net.h"
+
+// number of shards - one per character that game keys can start with (0-9, A-Z)
+#define CLUSTER_SHARDS 36
+// nodes that didn't sync for this long are considered down
+#define CLUSTER_NODE_TIMEOUT_MS (CLUSTER_SYNC_MS * 5)
+
+typedef struct cluster_node_t {
+	char address[CLUSTER_ADDRESS_LEN + 1]; //!< Node's public address (host:port)
+	unsigned long long sync_time;		   //!< Timestamp of the last sync (0: unknown node)
+	unsigned int load;					   //!< Number of games hosted by the node
+	pkt_game_data_t *games;				   //!< Node's public games (directory only)
+	unsigned int games_num;				   //!< Number of games received in the last sync
+	unsigned int games_size;			   //!< Allocated games capacity
+	unsigned int games_expected;		   //!< Number of games the current sync announced
+	net_endpoint_t *endpoint;			   //!< Connection the node syncs over (directory only)
+} cluster_node_t;
+
+typedef enum cluster_role_t {
+	CLUSTER_NONE	  = 0, //!< Standalone server
+	CLUSTER_NODE	  = 1, //!< Node hosting a shard of the games
+	CLUSTER_DIRECTORY = 2, //!< Directory of the nodes and their public games
+} cluster_role_t;
+
+static int cluster_node_thread(void *param);
+static net_err_t cluster_directory_respond(net_endpoint_t *endpoint, pkt_t *recv_pkt);
+static net_err_t cluster_send_redirect(net_endpoint_t *endpoint, const char *address);
+static int cluster_get_shard(const char *key);
+static bool cluster_node_alive(cluster_node_t *node);
+static void cluster_node_auth(const pkt_cluster_node_t *pkt, uint8_t *auth);
+static bool cluster_node_verify(net_endpoint_t *endpoint, const pkt_cluster_node_t *pkt);
+
+static cluster_role_t cluster_role = CLUSTER_NONE;	  //!< Role of this process
+static SDL_mutex *cluster_mutex	   = NULL;			  //!< Mutex locking the node table
+static cluster_node_t cluster_nodes[CLUSTER_SHARDS];  //!< Node table, indexed by shard
+static int cluster_shard		   = -1;			  //!< This node's shard
+static char cluster_address[CLUSTER_ADDRESS_LEN + 1]; //!< Directory address (node only)
+
+/**
+ * Start this server as a cluster node. The node hosts games whose keys begin with its shard's character,
+ * and periodically registers itself and its public games with the directory. Joins of other shards' games
+ * are redirected to their nodes; game list requests are redirected to the directory.
+ *
+ * @param directory directory address (host[:port])
+ * @param shard node's shard, 0..35
+ * @param address node's public address (host[:port]), NULL to use 127.0.0.1 and 'server_port'
+ * @return whether the node was started
+ */
+bool net_cluster_node_start(const char *directory, int shard, const char *address) {
+	if (shard < 0 || shard >= CLUSTER_SHARDS)
+		LT_ERR(E, return false, "Cluster: invalid shard %d (0..%d)", shard, CLUSTER_SHARDS - 1);
+	char *node_address;
+	MALLOC(node_address, CLUSTER_ADDRESS_LEN + 1, return false);
+	if (address != NULL)
+		strncpy2(node_address, address, CLUSTER_ADDRESS_LEN);
+	else
+		snprintf(node_address, CLUSTER_ADDRESS_LEN + 1, "127.0.0.1:%d", SETTINGS->server_port);
+
+	SDL_WITH_MUTEX(cluster_mutex) {
+		cluster_role  = CLUSTER_NODE;
+		cluster_shard = shard;
+		strncpy2(cluster_address, directory, CLUSTER_ADDRESS_LEN);
+		strncpy2(cluster_nodes[shard].address, node_address, CLUSTER_ADDRESS_LEN);
+	}
+
+	SDL_Thread *thread = SDL_CreateThread(cluster_node_thread, "cluster", node_address);
+	if (thread == NULL) {
+		free(node_address);
+		SDL_ERROR("SDL_CreateThread()", return false);
+	}
+	SDL_DetachThread(thread);
+	LT_I("Cluster: node of shard %d (%s), directory at %s", shard, node_address, directory);
+	return true;
+}
+
+/**
+ * Start this server as the cluster directory. The directory hosts no games - it keeps the table
+ * of nodes with their public games, answers game list requests with the merged list, and redirects
+ * join requests to the nodes hosting the games (and new game requests to the least loaded node).
+ */
+void net_cluster_directory_start() {
+	SDL_WITH_MUTEX(cluster_mutex) {
+		cluster_role = CLUSTER_DIRECTORY;
+	}
+	LT_I("Cluster: directory started");
+}
+
+/**
+ * Get the character that game keys of this node must start with.
+ *
+ * @return the shard's character, '\0' if not running as a cluster node
+ */
+char net_cluster_shard_char() {
+	if (cluster_role != CLUSTER_NODE)
+		return '\0';
+	return (char)(cluster_shard < 10 ? '0' + cluster_shard : 'A' + cluster_shard - 10);
+}
+
+/**
+ * Process a request received by the server, if this server is a part of a cluster.
+ *
+ * @param ret response error code (if handled)
+ * @return whether the request was handled; if not, it should be processed as usual
+ */
+bool net_cluster_respond(net_endpoint_t *endpoint, pkt_t *recv_pkt, net_err_t *ret) {
+	if (cluster_role == CLUSTER_NONE)
+		return false;
+	if (cluster_role == CLUSTER_DIRECTORY) {
+		*ret = cluster_directory_respond(endpoint, recv_pkt);
+		return true;
+	}
+
+	char address[CLUSTER_ADDRESS_LEN + 1] = {0};
+	switch (recv_pkt->hdr.type) {
+		case PKT_GAME_LIST:
+			// the directory has the games of all nodes
+			SDL_WITH_MUTEX(cluster_mutex) {
+				memcpy(address, cluster_address, sizeof(address));
+			}
+			*ret = cluster_send_redirect(endpoint, address);
+			return true;
+
+		case PKT_GAME_JOIN: {
+			int shard = cluster_get_shard(recv_pkt->game_join.key);
+			if (shard == cluster_shard || shard < 0)
+				// this node's game (or an invalid key)
+				return false;
+			SDL_WITH_MUTEX(cluster_mutex) {
+				if (cluster_node_alive(&cluster_nodes[shard]))
+					memcpy(address, cluster_nodes[shard].address, sizeof(address));
+			}
+			if (address[0] != '\0') {
+				*ret = cluster_send_redirect(endpoint, address);
+			} else {
+				pkt_error_t pkt = {
+					.hdr.type = PKT_ERROR,
+					.error	  = GAME_ERR_NOT_FOUND,
+				};
+				*ret = net_pkt_send(endpoint, (pkt_t *)&pkt);
+			}
+			return true;
+		}
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Directory: process a request of a node or a client.
+ *
+ * A node syncs by sending PKT_CLUSTER_NODE with 'count' set to the number of its public games,
+ * followed by that many PKT_GAME_DATA (with 'is_list'). The directory then replies with one
+ * PKT_CLUSTER_NODE per live node, 'count' being the number of entries that still follow.
+ * Nodes are only registered if authenticated with 'cluster_secret' (see cluster_node_verify()).
+ */
+static net_err_t cluster_directory_respond(net_endpoint_t *endpoint, pkt_t *recv_pkt) {
+	char address[CLUSTER_ADDRESS_LEN + 1] = {0};
+	net_err_t ret						  = NET_ERR_OK;
+	cluster_node_t *node;
+
+	switch (recv_pkt->hdr.type) {
+		case PKT_PING: {
+			recv_pkt->ping.recv_time = millis();
+			return net_pkt_send(endpoint, recv_pkt);
+		}
+
+		case PKT_CLUSTER_NODE: {
+			pkt_cluster_node_t *pkt = &recv_pkt->cluster_node;
+			if (pkt->shard >= CLUSTER_SHARDS)
+				return NET_ERR_OK;
+			if (!cluster_node_verify(endpoint, pkt)) {
+				LT_W("Cluster: rejected node of shard %u from %s", pkt->shard, net_endpoint_str(endpoint));
+				pkt_error_t pkt_err = {
+					.hdr.type = PKT_ERROR,
+					.error	  = GAME_ERR_INVALID_STATE,
+				};
+				return net_pkt_send(endpoint, (pkt_t *)&pkt_err);
+			}
+			SDL_LOCK_MUTEX(cluster_mutex);
+			node = &cluster_nodes[pkt->shard];
+			if (node->sync_time == 0)
+				LT_I("Cluster: node of shard %u registered (%s)", pkt->shard, pkt->address);
+			memcpy(node->address, pkt->address, sizeof(node->address));
+			node->address[CLUSTER_ADDRESS_LEN] = '\0';
+			node->sync_time					   = millis();
+			node->load						   = pkt->load;
+			node->endpoint					   = endpoint;
+			node->games_num					   = 0;
+			node->games_expected			   = pkt->count;
+
+			// reply with the node table
+			unsigned int alive = 0;
+			for (int i = 0; i < CLUSTER_SHARDS; i++) {
+				if (cluster_node_alive(&cluster_nodes[i]))
+					alive++;
+			}
+			for (int i = 0; i < CLUSTER_SHARDS && ret == NET_ERR_OK; i++) {
+				if (!cluster_node_alive(&cluster_nodes[i]))
+					continue;
+				pkt_cluster_node_t pkt_node = {
+					.hdr.type = PKT_CLUSTER_NODE,
+					.shard	  = i,
+					.load	  = cluster_nodes[i].load,
+					.count	  = --alive,
+				};
+				memcpy(pkt_node.address, cluster_nodes[i].address, sizeof(pkt_node.address));
+				ret = net_pkt_send(endpoint, (pkt_t *)&pkt_node);
+			}
+			SDL_UNLOCK_MUTEX(cluster_mutex);
+			return ret;
+		}
+
+		case PKT_GAME_DATA:
+			if (!recv_pkt->game_data.is_list)
+				return NET_ERR_OK;
+			SDL_LOCK_MUTEX(cluster_mutex);
+			for (int i = 0; i < CLUSTER_SHARDS; i++) {
+				node = &cluster_nodes[i];
+				if (node->endpoint != endpoint || node->games_num >= node->games_expected)
+					continue;
+				if (node->games_num == node->games_size) {
+					unsigned int size	   = node->games_size ? node->games_size * 2 : 16;
+					pkt_game_data_t *games = realloc(node->games, sizeof(*games) * size);
+					if (games == NULL)
+						break;
+					node->games		 = games;
+					node->games_size = size;
+				}
+				node->games[node->games_num++] = recv_pkt->game_data;
+				break;
+			}
+			SDL_UNLOCK_MUTEX(cluster_mutex);
+			return NET_ERR_OK;
+
+		case PKT_GAME_LIST: {
+			// send the merged list of all live nodes
+			unsigned int first = recv_pkt->game_list.page * recv_pkt->game_list.per_page;
+			unsigned int last  = first + recv_pkt->game_list.per_page;
+			unsigned int index = 0;
+			SDL_LOCK_MUTEX(cluster_mutex);
+			pkt_game_list_t pkt_list = {
+				.hdr.type = PKT_GAME_LIST,
+				.page	  = recv_pkt->game_list.page,
+				.per_page = recv_pkt->game_list.per_page,
+			};
+			for (int i = 0; i < CLUSTER_SHARDS; i++) {
+				if (cluster_node_alive(&cluster_nodes[i]))
+					pkt_list.total_count += cluster_nodes[i].games_num;
+			}
+			ret = net_pkt_send(endpoint, (pkt_t *)&pkt_list);
+			for (int i = 0; i < CLUSTER_SHARDS && ret == NET_ERR_OK && index < last; i++) {
+				node = &cluster_nodes[i];
+				if (!cluster_node_alive(node))
+					continue;
+				for (unsigned int j = 0; j < node->games_num && ret == NET_ERR_OK && index < last; j++) {
+					if (index++ < first)
+						continue;
+					ret = net_pkt_send(endpoint, (pkt_t *)&node->games[j]);
+				}
+			}
+			SDL_UNLOCK_MUTEX(cluster_mutex);
+			return ret;
+		}
+
+		case PKT_GAME_JOIN: {
+			int shard = cluster_get_shard(recv_pkt->game_join.key);
+			SDL_WITH_MUTEX(cluster_mutex) {
+				if (shard >= 0 && cluster_node_alive(&cluster_nodes[shard]))
+					memcpy(address, cluster_nodes[shard].address, sizeof(address));
+			}
+			if (address[0] != '\0')
+				return cluster_send_redirect(endpoint, address);
+			pkt_error_t pkt = {
+				.hdr.type = PKT_ERROR,
+				.error	  = GAME_ERR_NOT_FOUND,
+			};
+			return net_pkt_send(endpoint, (pkt_t *)&pkt);
+		}
+
+		case PKT_GAME_NEW: {
+			// create the game on the least loaded node
+			SDL_WITH_MUTEX(cluster_mutex) {
+				cluster_node_t *best = NULL;
+				for (int i = 0; i < CLUSTER_SHARDS; i++) {
+					node = &cluster_nodes[i];
+					if (cluster_node_alive(node) && (best == NULL || node->load < best->load))
+						best = node;
+				}
+				if (best == NULL)
+					continue;
+				memcpy(address, best->address, sizeof(address));
+				// count the game right away, so that the next requests spread out
+				best->load++;
+			}
+			if (address[0] != '\0')
+				return cluster_send_redirect(endpoint, address);
+			pkt_error_t pkt = {
+				.hdr.type = PKT_ERROR,
+				.error	  = GAME_ERR_SERVER_ERROR,
+			};
+			return net_pkt_send(endpoint, (pkt_t *)&pkt);
+		}
+
+		default: {
+			pkt_error_t pkt = {
+				.hdr.type = PKT_ERROR,
+				.error	  = GAME_ERR_INVALID_STATE,
+			};
+			return net_pkt_send(endpoint, (pkt_t *)&pkt);
+		}
+	}
+}
+
+/**
+ * Node: sync with the directory every CLUSTER_SYNC_MS, reconnecting if needed.
+ */
+static int cluster_node_thread(void *param) {
+	char *node_address = param;
+	lt_log_set_thread_name("cluster");
+	srand((unsigned int)time(NULL));
+
+	char directory[CLUSTER_ADDRESS_LEN + 1];
+	SDL_WITH_MUTEX(cluster_mutex) {
+		memcpy(directory, cluster_address, sizeof(directory));
+	}
+	net_endpoint_t endpoint = {
+		.type = NET_ENDPOINT_TLS,
+	};
+	pkt_t *pkt	   = &endpoint.recv.pkt;
+	bool connected = false;
+
+	while (cluster_role == CLUSTER_NODE) {
+		if (!connected) {
+			// check port number if specified
+			char host[CLUSTER_ADDRESS_LEN + 1];
+			int port = SETTINGS->server_port;
+			strncpy2(host, directory, CLUSTER_ADDRESS_LEN);
+			char *port_str = strchr(host, ':');
+			if (port_str != NULL) {
+				*port_str = '\0';
+				port	  = atoi(port_str + 1);
+			}
+			endpoint.addr.sin_family = AF_INET;
+			endpoint.addr.sin_port	 = htons(port);
+			endpoint.recv.buf		 = NULL;
+			if (!net_resolve_ip(host, &endpoint.addr.sin_addr) || net_endpoint_connect(&endpoint) != NET_ERR_OK) {
+				LT_W("Cluster: couldn't connect to the directory at %s", directory);
+				net_endpoint_free(&endpoint);
+				SDL_Delay(CLUSTER_SYNC_MS);
+				continue;
+			}
+			LT_I("Cluster: connected to the directory at %s", net_endpoint_str(&endpoint));
+			connected = true;
+		}
+
+		// collect the public games
+		SDL_mutex *game_list_mutex;
+		game_t *game_list		 = game_get_list(&game_list_mutex);
+		pkt_game_data_t *games	 = NULL;
+		unsigned int games_num	 = 0;
+		unsigned int games_total = 0;
+		SDL_WITH_MUTEX(game_list_mutex) {
+			game_t *game;
+			DL_FOREACH(game_list, game) {
+				games_total++;
+				if (game->is_public)
+					games_num++;
+			}
+			games = calloc(max(games_num, 1), sizeof(*games));
+			if (games == NULL) {
+				games_num = 0;
+				continue;
+			}
+			unsigned int i = 0;
+			DL_FOREACH(game_list, game) {
+				if (!game->is_public)
+					continue;
+				games[i].hdr.type = PKT_GAME_DATA;
+				games[i].is_list  = true;
+				game_fill_data_pkt(game, &games[i++]);
+			}
+		}
+
+		// register with the directory, then send the games
+		pkt_cluster_node_t pkt_node = {
+			.hdr.type = PKT_CLUSTER_NODE,
+			.shard	  = cluster_shard,
+			.load	  = games_total,
+			.count	  = games_num,
+		};
+		strncpy2(pkt_node.address, node_address, CLUSTER_ADDRESS_LEN);
+		cluster_node_auth(&pkt_node, pkt_node.auth);
+		net_err_t err = net_pkt_send(&endpoint, (pkt_t *)&pkt_node);
+		for (unsigned int i = 0; i < games_num && err == NET_ERR_OK; i++) {
+			err = net_pkt_send(&endpoint, (pkt_t *)&games[i]);
+		}
+		free(games);
+
+		// receive the node table
+		while (err >= NET_ERR_OK) {
+			if ((err = net_pkt_recv(&endpoint)) < NET_ERR_OK)
+				break;
+			if (err == NET_ERR_OK_PACKET && pkt->hdr.type == PKT_ERROR) {
+				LT_E("Cluster: the directory refused the node (check 'cluster_secret')");
+				break;
+			}
+			if (err != NET_ERR_OK_PACKET || pkt->hdr.type != PKT_CLUSTER_NODE)
+				continue;
+			if (pkt->cluster_node.shard < CLUSTER_SHARDS && pkt->cluster_node.shard != cluster_shard) {
+				SDL_WITH_MUTEX(cluster_mutex) {
+					cluster_node_t *node = &cluster_nodes[pkt->cluster_node.shard];
+					memcpy(node->address, pkt->cluster_node.address, sizeof(node->address));
+					node->address[CLUSTER_ADDRESS_LEN] = '\0';
+					node->sync_time					   = millis();
+					node->load						   = pkt->cluster_node.load;
+				}
+			}
+			if (pkt->cluster_node.count == 0)
+				break;
+		}
+		if (err < NET_ERR_OK) {
+			LT_W("Cluster: lost connection to the directory");
+			net_endpoint_free(&endpoint);
+			connected = false;
+		}
+		SDL_Delay(CLUSTER_SYNC_MS);
+	}
+
+	net_endpoint_free(&endpoint);
+	SDL_DestroyMutex(endpoint.mutex);
+	free(node_address);
+	return 0;
+}
+
+static net_err_t cluster_send_redirect(net_endpoint_t *endpoint, const char *address) {
+	pkt_redirect_t pkt = {
+		.hdr.type = PKT_REDIRECT,
+	};
+	strncpy2(pkt.address, address, CLUSTER_ADDRESS_LEN);
+	return net_pkt_send(endpoint, (pkt_t *)&pkt);
+}
+
+/**
+ * Get the shard of the game key (its first character).
+ *
+ * @return shard, -1 if the key is invalid
+ */
+static int cluster_get_shard(const char *key) {
+	char ch = (char)toupper(key[0]);
+	if (ch >= '0' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'A' && ch <= 'Z')
+		return ch - 'A' + 10;
+	return -1;
+}
+
+static bool cluster_node_alive(cluster_node_t *node) {
+	return node->sync_time != 0 && millis() - node->sync_time < CLUSTER_NODE_TIMEOUT_MS;
+}
+
+/**
+ * Compute the authentication code of the node's registration, from its shard and address.
+ * Without 'cluster_secret', the code is all zeros.
+ */
+static void cluster_node_auth(const pkt_cluster_node_t *pkt, uint8_t *auth) {
+	memset(auth, 0, sizeof(pkt->auth));
+	if (SETTINGS->cluster_secret == NULL)
+		return;
+	uint8_t data[sizeof(pkt->shard) + CLUSTER_ADDRESS_LEN] = {0};
+	size_t address_len									   = strnlen(pkt->address, CLUSTER_ADDRESS_LEN);
+	memcpy(data, &pkt->shard, sizeof(pkt->shard));
+	memcpy(data + sizeof(pkt->shard), pkt->address, address_len);
+	HMAC(
+		EVP_sha256(),
+		SETTINGS->cluster_secret,
+		(int)strlen(SETTINGS->cluster_secret),
+		data,
+		sizeof(pkt->shard) + address_len,
+		auth,
+		NULL
+	);
+}
+
+/**
+ * Check whether the node is allowed to register with the directory. With 'cluster_secret' set,
+ * the registration must carry its authentication code; otherwise, only nodes on the same host are allowed.
+ */
+static bool cluster_node_verify(net_endpoint_t *endpoint, const pkt_cluster_node_t *pkt) {
+	if (SETTINGS->cluster_secret == NULL)
+		return (ntohl(endpoint->addr.sin_addr.s_addr) >> 24) == 127;
+	uint8_t auth[sizeof(pkt->auth)];
+	cluster_node_auth(pkt, auth);
+	return CRYPTO_memcmp(auth, pkt->auth, sizeof(auth)) == 0;
+}
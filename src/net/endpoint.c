@@ -30,10 +30,15 @@ const char *net_endpoint_str(net_endpoint_t *endpoint) {
 	return str_buf;
 }
 
-net_endpoint_t *net_endpoint_dup(net_endpoint_t *endpoint) {
+/**
+ * Duplicate the endpoint into a new allocation.
+ *
+ * @param arena arena to allocate from (NULL to use malloc()); free with arena_free() accordingly
+ */
+net_endpoint_t *net_endpoint_dup(net_endpoint_t *endpoint, arena_t *arena) {
 	// allocate memory
 	net_endpoint_t *item;
-	MALLOC(item, sizeof(*item), return NULL);
+	ARENA_MALLOC(arena, item, sizeof(*item), return NULL);
 	*item		= *endpoint;
 	item->mutex = NULL;
 #if WIN32
@@ -79,6 +84,10 @@ net_err_t net_endpoint_listen(net_endpoint_t *endpoint) {
 			SSL_ERROR("SSL_CTX_use_RSAPrivateKey()", ret = NET_ERR_SSL_CERT; goto cleanup);
 	}
 
+	if (endpoint->fd > 0)
+		// listening socket taken over from another process (see net_handoff_receive())
+		goto listening;
+
 	int sfd = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 	if (sfd == -1)
 		SOCK_ERROR("socket()", ret = NET_ERR_SOCKET; goto cleanup);
@@ -98,6 +107,7 @@ net_err_t net_endpoint_listen(net_endpoint_t *endpoint) {
 
 	// server started successfully, fill net_endpoint_t*
 	endpoint->fd = sfd;
+listening:
 #if WIN32
 	endpoint->pipe.event = WSACreateEvent();
 #endif
@@ -132,6 +142,9 @@ net_err_t net_endpoint_accept(const net_endpoint_t *endpoint, net_endpoint_t *cl
 			ret = NET_ERR_CLIENT_CLOSED;
 		if (errno == ECONNRESET)
 			ret = NET_ERR_CLIENT_CLOSED;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			// taken by another process sharing the socket (handoff)
+			ret = NET_ERR_CLIENT_CLOSED;
 		if (errno == EINTR)
 			ret = NET_ERR_SERVER_CLOSED;
 		if (errno == EBADF)
@@ -239,9 +252,6 @@ void net_endpoint_close(net_endpoint_t *endpoint) {
 		if (endpoint->pipe.event != NULL)
 			WSASetEvent(endpoint->pipe.event);
 #endif
-
-		if (endpoint->ping_sem != NULL)
-			SDL_SemPost(endpoint->ping_sem);
 	}
 }
 
@@ -270,9 +280,6 @@ void net_endpoint_free(net_endpoint_t *endpoint) {
 		if (endpoint->type <= NET_ENDPOINT_TLS)
 			WSACleanup();
 #endif
-
-		if (endpoint->ping_sem != NULL)
-			SDL_DestroySemaphore(endpoint->ping_sem);
 	}
 }
 
@@ -0,0 +1,146 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-13.
+
+#include "net.h"
+
+#if __linux__
+#include <sys/un.h>
+
+static int net_handoff_thread(net_t *server);
+static int net_handoff_socket(const char *path, struct sockaddr_un *addr);
+#endif
+
+/**
+ * Take over the listening socket of a server process being replaced, if there's one.
+ *
+ * The other process sends its listening socket over the UNIX socket at 'handoff_socket' (SCM_RIGHTS),
+ * stops accepting connections and keeps running its games until they finish. Connections that were
+ * already established can't be taken over - their TLS sessions only exist in the other process.
+ *
+ * @return the listening socket, 0 if there's no process to take over (or on error)
+ */
+int net_handoff_receive() {
+#if __linux__
+	if (SETTINGS->handoff_socket == NULL)
+		return 0;
+	struct sockaddr_un addr;
+	int ufd = net_handoff_socket(SETTINGS->handoff_socket, &addr);
+	if (ufd == -1)
+		return 0;
+	if (connect(ufd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		// nothing to take over
+		close(ufd);
+		return 0;
+	}
+
+	// receive the listening socket
+	char data;
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov  = {.iov_base = &data, .iov_len = sizeof(data)};
+	struct msghdr msg = {
+		.msg_iov		= &iov,
+		.msg_iovlen		= 1,
+		.msg_control	= control,
+		.msg_controllen = sizeof(control),
+	};
+	int fd = 0;
+	if (recvmsg(ufd, &msg, 0) <= 0) {
+		LT_E("Handoff: couldn't receive the listening socket: %s", strerror(errno));
+	} else {
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+		LT_I("Handoff: took over the listening socket fd=%d", fd);
+	}
+	close(ufd);
+	return fd;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Wait for a new server process on the UNIX socket at 'handoff_socket', in a separate thread,
+ * and hand the listening socket over to it. This process then stops accepting connections
+ * (see net_server_listen()), and exits when all its games are finished.
+ */
+void net_handoff_start(net_t *server) {
+#if __linux__
+	if (SETTINGS->handoff_socket == NULL)
+		return;
+	SDL_Thread *thread = SDL_CreateThread((SDL_ThreadFunction)net_handoff_thread, "handoff", server);
+	if (thread == NULL)
+		SDL_ERROR("SDL_CreateThread()", return);
+	SDL_DetachThread(thread);
+#else
+	if (SETTINGS->handoff_socket != NULL)
+		LT_W("Handoff: only supported on Linux");
+#endif
+}
+
+#if __linux__
+static int net_handoff_thread(net_t *server) {
+	lt_log_set_thread_name("handoff");
+
+	struct sockaddr_un addr;
+	int ufd = net_handoff_socket(SETTINGS->handoff_socket, &addr);
+	if (ufd == -1)
+		return -1;
+	// the socket of a previous process might still exist
+	unlink(addr.sun_path);
+	if (bind(ufd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(ufd, 1) != 0) {
+		LT_E("Handoff: couldn't listen on '%s': %s", addr.sun_path, strerror(errno));
+		close(ufd);
+		return -1;
+	}
+	LT_I("Handoff: waiting for a new process on '%s'", addr.sun_path);
+
+	int cfd;
+	while ((cfd = accept(ufd, NULL, NULL)) == -1) {
+		if (errno != EINTR) {
+			LT_E("Handoff: accept() failed: %s", strerror(errno));
+			close(ufd);
+			return -1;
+		}
+	}
+
+	// both processes accept on the socket until this one stops, so it mustn't block anymore
+	int fd = server->endpoint.fd;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	// send the listening socket
+	char data = 'Z';
+	char control[CMSG_SPACE(sizeof(int))] = {0};
+	struct iovec iov  = {.iov_base = &data, .iov_len = sizeof(data)};
+	struct msghdr msg = {
+		.msg_iov		= &iov,
+		.msg_iovlen		= 1,
+		.msg_control	= control,
+		.msg_controllen = sizeof(control),
+	};
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level	 = SOL_SOCKET;
+	cmsg->cmsg_type		 = SCM_RIGHTS;
+	cmsg->cmsg_len		 = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+	bool sent = sendmsg(cfd, &msg, 0) == sizeof(data);
+	// the new process binds the socket's path now - don't unlink it
+	close(cfd);
+	close(ufd);
+	if (!sent)
+		LT_ERR(E, return -1, "Handoff: couldn't send the listening socket: %s", strerror(errno));
+
+	LT_I("Handoff: listening socket handed over, finishing the running games");
+	server->handoff = true;
+	return 0;
+}
+
+static int net_handoff_socket(const char *path, struct sockaddr_un *addr) {
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strncpy2(addr->sun_path, path, sizeof(addr->sun_path) - 1);
+	int ufd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (ufd == -1)
+		LT_ERR(E, return -1, "Handoff: socket() failed: %s", strerror(errno));
+	return ufd;
+}
+#endif
@@ -50,7 +50,8 @@ typedef struct net_endpoint_t {
 	unsigned long long ping_time; //!< Ping send timestamp
 	unsigned int ping_rtt;		  //!< Ping round-trip time
 	long long time_delta;		  //!< Time delta (server_time-client_time)
-	SDL_sem *ping_sem;			  //!< Ping response semaphore
+	bool ping_ok;				  //!< Whether a ping response was received (match time sync)
+	unsigned int spectators;	  //!< Number of spectating players joined on this endpoint (game only)
 
 	struct sockaddr_in addr; //!< Endpoint address
 	int fd;					 //!< Socket descriptor
@@ -80,6 +81,9 @@ typedef struct net_t {
 	bool stop;				 //!< Whether the thread should stop gracefully
 	game_t *game;			 //!< Joined game (client only)
 	bool is_local;			 //!< Whether it's a local game server
+	pkt_t request;			 //!< Last request sent to the server, repeated when redirected (client only)
+	unsigned int redirects;	 //!< Number of redirects followed (client only)
+	bool handoff;			 //!< Whether the listening socket was handed off to a new process (server only)
 } net_t;
 
 typedef net_err_t (*net_select_read_cb_t)(net_endpoint_t *endpoint, void *param);
@@ -91,10 +95,11 @@ net_err_t net_pkt_recv(net_endpoint_t *endpoint);
 net_err_t net_pkt_send(net_endpoint_t *endpoint, pkt_t *pkt);
 net_err_t net_pkt_send_pipe(net_endpoint_t *endpoint, pkt_t *pkt);
 net_err_t net_pkt_broadcast(net_endpoint_t *endpoints, pkt_t *pkt, net_endpoint_t *source);
+pkt_t *net_pkt_queue_pop();
 
 // endpoint.c
 const char *net_endpoint_str(net_endpoint_t *endpoint);
-net_endpoint_t *net_endpoint_dup(net_endpoint_t *endpoint);
+net_endpoint_t *net_endpoint_dup(net_endpoint_t *endpoint, arena_t *arena);
 net_err_t net_endpoint_pipe(net_endpoint_t *endpoint);
 net_err_t net_endpoint_listen(net_endpoint_t *endpoint);
 net_err_t net_endpoint_accept(const net_endpoint_t *endpoint, net_endpoint_t *client);
@@ -123,3 +128,13 @@ void net_server_stop();
 // client.c
 net_endpoint_t *net_client_start(const char *address, bool use_tls);
 void net_client_stop();
+
+// cluster.c
+bool net_cluster_node_start(const char *directory, int shard, const char *address);
+void net_cluster_directory_start();
+char net_cluster_shard_char();
+bool net_cluster_respond(net_endpoint_t *endpoint, pkt_t *recv_pkt, net_err_t *ret);
+
+// handoff.c
+int net_handoff_receive();
+void net_handoff_start(net_t *server);
@@ -23,6 +23,11 @@ typedef enum {
 	PKT_PLAYER_LEAVE,	   //!< Player leave event
 	PKT_REQUEST_SEND_DATA, //!< Request to broadcast game data
 	PKT_REQUEST_TIME_SYNC, //!< Request to ping all endpoints
+	PKT_PLAYER_HASH,	   //!< Player state hash (desync detection)
+	PKT_PLAYER_STATE,	   //!< Authoritative player state (desync correction)
+	PKT_SPECTATE_FRAME,	   //!< Players' positions for spectators (variable length)
+	PKT_REDIRECT,		   //!< Request redirected to another server (cluster)
+	PKT_CLUSTER_NODE,	   //!< Cluster node registration/directory entry
 	PKT_MAX,
 } pkt_type_t;
 
@@ -99,6 +104,7 @@ typedef PACK(struct pkt_player_new_t {
 	pkt_hdr_t hdr;
 	char name[PLAYER_NAME_LEN + 1];
 	STRUCT_PADDING(name, PLAYER_NAME_LEN + 1);
+	uint32_t is_spectator;
 }) pkt_player_new_t;
 
 typedef PACK(struct pkt_player_data_t {
@@ -136,6 +142,56 @@ typedef PACK(struct pkt_request_time_sync_t {
 	//
 }) pkt_request_time_sync_t;
 
+typedef PACK(struct pkt_player_hash_t {
+	pkt_hdr_t hdr;
+	uint32_t id;
+	uint32_t tick; //!< Round tick of the hashed position
+	uint32_t hash; //!< Hash of the player's position (see player_position_hash())
+}) pkt_player_hash_t;
+
+typedef PACK(struct pkt_player_state_t {
+	pkt_hdr_t hdr;
+	uint32_t id;
+	uint32_t tick; //!< Round tick of the position
+	uint32_t time;
+	uint32_t angle;
+	double speed;
+	double x;
+	double y;
+	uint32_t lap;
+	player_pos_dir_t direction : 32;
+	uint32_t lap_can_advance;
+	player_state_t state : 32; //!< Player state, if the player stopped at this position (PLAYING otherwise)
+}) pkt_player_state_t;
+
+// maximum length of a single player entry in pkt_spectate_frame_t
+#define PKT_SPECTATE_POS_MAX_LEN 10
+
+typedef PACK(struct pkt_spectate_frame_t {
+	pkt_hdr_t hdr;
+	uint32_t tick;	  //!< Round tick of the frame
+	uint8_t keyframe; //!< Keyframe part number, from 1 (all entries absolute), 0 for delta frames
+	uint8_t count;	  //!< Number of player entries
+	uint16_t reserved;
+	uint8_t data[SPECTATE_FRAME_PLAYERS * PKT_SPECTATE_POS_MAX_LEN]; //!< Player entries (see spectate.c)
+}) pkt_spectate_frame_t;
+
+typedef PACK(struct pkt_redirect_t {
+	pkt_hdr_t hdr;
+	char address[CLUSTER_ADDRESS_LEN + 1]; //!< Server to repeat the request on (host:port)
+	STRUCT_PADDING(address, CLUSTER_ADDRESS_LEN + 1);
+}) pkt_redirect_t;
+
+typedef PACK(struct pkt_cluster_node_t {
+	pkt_hdr_t hdr;
+	uint32_t shard;						   //!< Node's shard (index of the first character of its game keys)
+	uint32_t load;						   //!< Number of games hosted by the node
+	uint32_t count;						   //!< Number of packets that follow (see cluster.c)
+	uint8_t auth[32];					   //!< HMAC-SHA256 of 'shard' and 'address', keyed with 'cluster_secret'
+	char address[CLUSTER_ADDRESS_LEN + 1]; //!< Node's public address (host:port)
+	STRUCT_PADDING(address, CLUSTER_ADDRESS_LEN + 1);
+}) pkt_cluster_node_t;
+
 typedef PACK(union pkt_t {
 	pkt_hdr_t hdr;
 	pkt_ping_t ping;
@@ -153,4 +209,9 @@ typedef PACK(union pkt_t {
 	pkt_player_leave_t player_leave;
 	pkt_request_send_data_t request_send_data;
 	pkt_request_time_sync_t request_time_sync;
+	pkt_player_hash_t player_hash;
+	pkt_player_state_t player_state;
+	pkt_spectate_frame_t spectate_frame;
+	pkt_redirect_t redirect;
+	pkt_cluster_node_t cluster_node;
 }) pkt_t;
@@ -2,6 +2,16 @@
 
 #include "net.h"
 
+typedef struct pkt_queue_item_t {
+	pkt_t *pkt; //!< Queued packet (allocated)
+	struct pkt_queue_item_t *prev, *next;
+} pkt_queue_item_t;
+
+static SDL_SpinLock pkt_queue_lock = 0;	   //!< Lock of the UI packet queue (usable without creating it first)
+static pkt_queue_item_t *pkt_queue = NULL; //!< Packets sent to the UI, not processed yet
+
+static void net_pkt_queue_push(pkt_t *pkt);
+
 static const unsigned int pkt_len_list[] = {
 	0,
 	sizeof(pkt_ping_t),
@@ -19,6 +29,11 @@ static const unsigned int pkt_len_list[] = {
 	sizeof(pkt_player_leave_t),
 	sizeof(pkt_request_send_data_t),
 	sizeof(pkt_request_time_sync_t),
+	sizeof(pkt_player_hash_t),
+	sizeof(pkt_player_state_t),
+	sizeof(pkt_spectate_frame_t),
+	sizeof(pkt_redirect_t),
+	sizeof(pkt_cluster_node_t),
 };
 
 static const char *pkt_name_list[] = {
@@ -38,8 +53,25 @@ static const char *pkt_name_list[] = {
 	"PKT_PLAYER_LEAVE",
 	"PKT_REQUEST_SEND_DATA",
 	"PKT_REQUEST_TIME_SYNC",
+	"PKT_PLAYER_HASH",
+	"PKT_PLAYER_STATE",
+	"PKT_SPECTATE_FRAME",
+	"PKT_REDIRECT",
+	"PKT_CLUSTER_NODE",
 };
 
+/**
+ * Get the expected length of the packet. Variable-length packets (whose maximum length is in
+ * 'pkt_len_list') keep the length set by the sender; all other packets have a fixed length.
+ */
+static unsigned int net_pkt_len(pkt_t *pkt) {
+	unsigned int max_len = pkt_len_list[pkt->hdr.type];
+	if (pkt->hdr.type == PKT_SPECTATE_FRAME && pkt->hdr.len >= offsetof(pkt_spectate_frame_t, data) &&
+		pkt->hdr.len <= max_len)
+		return pkt->hdr.len;
+	return max_len;
+}
+
 /**
  * Allocate and copy a packet.
  *
@@ -110,7 +142,7 @@ net_err_t net_pkt_recv(net_endpoint_t *endpoint) {
 		return NET_ERR_PKT_TYPE;
 	}
 	// check if the length matches
-	if (pkt->hdr.len != pkt_len_list[pkt->hdr.type]) {
+	if (pkt->hdr.len != net_pkt_len(pkt)) {
 		LT_E("Packet length invalid (%d != %d)", pkt->hdr.len, pkt_len_list[pkt->hdr.type]);
 		endpoint->recv.buf = endpoint->recv.start;
 		return NET_ERR_PKT_LENGTH;
@@ -131,7 +163,7 @@ net_err_t net_pkt_recv(net_endpoint_t *endpoint) {
 
 /**
  * Send a single pkt_t if the endpoint is a socket.
- * If the endpoint is a pipe and if 'endpoint->pipe.no_sdl' is not set, send an SDL event.
+ * If the endpoint is a pipe and if 'endpoint->pipe.no_sdl' is not set, queue the packet for the UI.
  * Otherwise, do nothing.
  *
  * @param endpoint where to send the packet to
@@ -140,17 +172,16 @@ net_err_t net_pkt_recv(net_endpoint_t *endpoint) {
  */
 net_err_t net_pkt_send(net_endpoint_t *endpoint, pkt_t *pkt) {
 	pkt->hdr.protocol = NET_PROTOCOL;
-	pkt->hdr.len	  = pkt_len_list[pkt->hdr.type];
+	pkt->hdr.len	  = net_pkt_len(pkt);
 
 	if (endpoint->type == NET_ENDPOINT_PIPE) {
 		if (endpoint->pipe.no_sdl)
 			return NET_ERR_OK;
-		SDL_Event user = {
-			.user.type	= SDL_USEREVENT_PACKET,
-			.user.data1 = net_pkt_dup(pkt),
-		};
-		SDL_PushEvent(&user);
-		LT_D("Packet %s sent (%d bytes) -> SDL", pkt_name_list[pkt->hdr.type], pkt->hdr.len);
+		pkt_t *dup = net_pkt_dup(pkt);
+		if (dup == NULL)
+			return NET_ERR_MALLOC;
+		net_pkt_queue_push(dup);
+		LT_D("Packet %s sent (%d bytes) -> UI", pkt_name_list[pkt->hdr.type], pkt->hdr.len);
 	} else {
 		net_err_t err;
 		if ((err = net_endpoint_send(endpoint, (const char *)pkt, pkt->hdr.len)) != NET_ERR_OK)
@@ -174,7 +205,7 @@ net_err_t net_pkt_send(net_endpoint_t *endpoint, pkt_t *pkt) {
  */
 net_err_t net_pkt_send_pipe(net_endpoint_t *endpoint, pkt_t *pkt) {
 	pkt->hdr.protocol = NET_PROTOCOL;
-	pkt->hdr.len	  = pkt_len_list[pkt->hdr.type];
+	pkt->hdr.len	  = net_pkt_len(pkt);
 
 	while (endpoint != NULL && endpoint->type != NET_ENDPOINT_PIPE) {
 		endpoint = endpoint->next;
@@ -213,3 +244,37 @@ net_err_t net_pkt_broadcast(net_endpoint_t *endpoints, pkt_t *pkt, net_endpoint_
 	}
 	return ret;
 }
+
+/**
+ * Append a packet to the UI packet queue, and wake up the UI thread.
+ * Packets are queued (instead of being sent in SDL events) so that they're never dropped
+ * when the SDL event queue is full, and the UI can process all of them at once.
+ */
+static void net_pkt_queue_push(pkt_t *pkt) {
+	pkt_queue_item_t *item;
+	MALLOC(item, sizeof(*item), free(pkt); return);
+	item->pkt = pkt;
+	SDL_AtomicLock(&pkt_queue_lock);
+	DL_APPEND(pkt_queue, item);
+	SDL_AtomicUnlock(&pkt_queue_lock);
+	wakeup_ui();
+}
+
+/**
+ * UI thread: take the oldest packet out of the UI packet queue.
+ *
+ * @return the packet (must be freed by the caller), NULL if the queue is empty
+ */
+pkt_t *net_pkt_queue_pop() {
+	pkt_queue_item_t *item;
+	SDL_AtomicLock(&pkt_queue_lock);
+	item = pkt_queue;
+	if (item != NULL)
+		DL_DELETE(pkt_queue, item);
+	SDL_AtomicUnlock(&pkt_queue_lock);
+	if (item == NULL)
+		return NULL;
+	pkt_t *pkt = item->pkt;
+	free(item);
+	return pkt;
+}
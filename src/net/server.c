@@ -63,6 +63,9 @@ static int net_server_listen(void *param) {
 	// listen on any address
 	memset(&saddr.sin_addr, 0, sizeof(saddr.sin_addr));
 	server->endpoint.addr = saddr;
+	// take over the socket of a running server, if there's one
+	if (!server->is_local)
+		server->endpoint.fd = net_handoff_receive();
 	if (net_endpoint_listen(&server->endpoint) != NET_ERR_OK)
 		goto error_start;
 
@@ -74,8 +77,19 @@ static int net_server_listen(void *param) {
 	);
 	event.user.code = true;
 	SDL_PushEvent(&event);
+	// let the next server process take over
+	if (!server->is_local)
+		net_handoff_start(server);
 
 	while (!server->stop) {
+#if !WIN32
+		if (server->handoff)
+			goto handoff;
+		// wait for a connection with a timeout, to notice the handoff without accepting
+		struct pollfd pfd = {.fd = server->endpoint.fd, .events = POLLIN};
+		if (poll(&pfd, 1, 500) == 0)
+			continue;
+#endif
 		// accept an incoming connection
 		net_err_t err;
 		if ((err = net_endpoint_accept(&server->endpoint, &client->endpoint)) != NET_ERR_OK) {
@@ -121,6 +135,21 @@ static int net_server_listen(void *param) {
 		}
 	}
 
+#if !WIN32
+handoff:
+	// the socket is shared with the new process now - close it without shutdown()
+	SDL_WITH_MUTEX(server->endpoint.mutex) {
+		close(server->endpoint.fd);
+		server->endpoint.fd = 0;
+	}
+	// keep serving the running games until they finish
+	game_pool_stop();
+	while (!server->stop && game_get_list(NULL) != NULL)
+		SDL_Delay(1000);
+	LT_I("Server: all games finished after the handoff");
+	goto cleanup;
+#endif
+
 error_start:
 	LT_E("Couldn't start the game server");
 	event.user.code = false;
@@ -196,6 +225,10 @@ exit_thread:
 static net_err_t net_server_respond(net_endpoint_t *endpoint, pkt_t *recv_pkt) {
 	if (server == NULL)
 		return NET_ERR_SERVER_CLOSED;
+	net_err_t ret;
+	if (net_cluster_respond(endpoint, recv_pkt, &ret))
+		// answered or redirected by the cluster
+		return ret;
 	switch (recv_pkt->hdr.type) {
 		case PKT_PING: {
 			unsigned long long local_time = millis();
@@ -252,7 +285,22 @@ static net_err_t net_server_respond(net_endpoint_t *endpoint, pkt_t *recv_pkt) {
 		}
 
 		case PKT_GAME_NEW: {
-			game_t *game	= game_init(NULL);
+			if (server->handoff) {
+				// the new server process takes the new games, this one only finishes the running ones
+				pkt_error_t pkt = {
+					.hdr.type = PKT_ERROR,
+					.error	  = GAME_ERR_RESTARTING,
+				};
+				return net_pkt_send(endpoint, (pkt_t *)&pkt);
+			}
+			game_t *game = game_pool_claim();
+			if (game == NULL) {
+				pkt_error_t pkt = {
+					.hdr.type = PKT_ERROR,
+					.error	  = GAME_ERR_SERVER_ERROR,
+				};
+				return net_pkt_send(endpoint, (pkt_t *)&pkt);
+			}
 			game->is_public = recv_pkt->game_new.is_public;
 			game->is_local	= server->is_local;
 			// pass the endpoint to the game thread, duplicating it
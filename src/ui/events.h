@@ -9,6 +9,7 @@ enum {
 	SDL_USEREVENT_PACKET, //!< Packet has been received
 	SDL_USEREVENT_GAME,	  //!< Instance of game_t* is available, or game just stopped
 	SDL_USEREVENT_MATCH,  //!< Match update
+	SDL_USEREVENT_WAKEUP, //!< Shared state changed (see wakeup_ui())
 };
 
 enum {
@@ -189,7 +189,7 @@ static void ui_update_player(ui_t *ui, player_t *player) {
 			color = GFX_COLOR_BRIGHT_GREEN;
 			break;
 		case PLAYER_PLAYING:
-			snprintf(status, sizeof(status), "In Game \x07 Lap %u/4", player->pos[0].lap);
+			snprintf(status, sizeof(status), "In Game \x07 Lap %u/4", PLAYER_POS(player, 0)->lap);
 			break;
 		case PLAYER_CRASHED:
 			strcpy(status, "Crashed!");
@@ -353,8 +353,8 @@ static bool on_btn_ready(view_t *view, SDL_Event *e, ui_t *ui) {
 			ready_changed = true;
 		}
 		if (ready_changed) {
-			// post the ready state semaphore
-			SDL_SemPost(GAME->ready_sem);
+			// wake up the match waiting for ready state
+			match_wake(GAME);
 			// update UI state
 			ui_update_player(ui, player);
 			ui_update_status(ui);
@@ -506,6 +506,10 @@ static bool on_event(ui_t *ui, fragment_t *fragment, SDL_Event *e) {
 					}
 					ui_state_set(ui, UI_STATE_MATCH);
 					break;
+				case PKT_SPECTATE_FRAME:
+					// spectating: watch the ongoing round
+					ui_state_set(ui, UI_STATE_MATCH);
+					break;
 				case PKT_GAME_STOP:
 					// game stopped - we're most likely spectating
 					ui_update_players(ui);
@@ -15,7 +15,8 @@ static view_t *players_list	 = NULL;
 static view_t *player_state	 = NULL;
 static view_t *ready_info	 = NULL;
 
-static bool first_draw = false;
+static bool first_draw			= false;
+static SDL_Texture *trail_layer = NULL; //!< Trails of all players
 
 static void match_update_redraw_all(ui_t *ui);
 static void match_update_state(ui_t *ui);
@@ -55,18 +56,7 @@ static void match_update_redraw_all(ui_t *ui) {
 	match_update_state(ui);
 	match_update_player_state(ui);
 
-	SDL_WITH_MUTEX(GAME->mutex) {
-		player_t *player;
-		DL_FOREACH(GAME->players, player) {
-			if (player->state != PLAYER_PLAYING && player->state != PLAYER_CRASHED && player->state != PLAYER_FINISHED)
-				continue;
-			SDL_WITH_MUTEX(player->mutex) {
-				SDL_SetRenderTarget(ui->renderer, player->texture);
-				match_gfx_player_draw(ui->renderer, player);
-			}
-		}
-	}
-	SDL_SetRenderTarget(ui->renderer, NULL);
+	match_update_players(ui, true);
 }
 
 static void match_update_state(ui_t *ui) {
@@ -178,20 +168,10 @@ static void match_update_player_state(ui_t *ui) {
 }
 
 static void match_update_players(ui_t *ui, bool redraw) {
-	SDL_WITH_MUTEX(GAME->mutex) {
-		player_t *player;
-		DL_FOREACH(GAME->players, player) {
-			if (!player->is_in_round)
-				continue;
-			SDL_WITH_MUTEX(player->mutex) {
-				SDL_SetRenderTarget(ui->renderer, player->texture);
-				if (redraw)
-					match_gfx_player_draw(ui->renderer, player);
-				else
-					match_gfx_player_draw_step(ui->renderer, player);
-			}
-		}
-	}
+	// draw the latest published state, without locking the match
+	match_snapshot_t *snapshot = match_snapshot_acquire(GAME);
+	SDL_SetRenderTarget(ui->renderer, trail_layer);
+	match_gfx_trails_draw(ui->renderer, snapshot, redraw);
 	SDL_SetRenderTarget(ui->renderer, NULL);
 }
 
@@ -207,14 +187,10 @@ static void on_draw(SDL_Renderer *renderer, view_t *view) {
 			SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 640, 480);
 		SDL_SetTextureBlendMode(canvas->data.canvas.texture, SDL_BLENDMODE_BLEND);
 
-		player_t *player;
-		DL_FOREACH(GAME->players, player) {
-			if ((player->state & PLAYER_IN_GAME_MASK) == 0)
-				continue;
-			SDL_DestroyTexture(player->texture);
-			player->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 640, 480);
-			SDL_SetTextureBlendMode(player->texture, SDL_BLENDMODE_BLEND);
-		}
+		// one layer for all players' trails
+		SDL_DestroyTexture(trail_layer);
+		trail_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 640, 480);
+		SDL_SetTextureBlendMode(trail_layer, SDL_BLENDMODE_BLEND);
 
 		// make the UI redraw everything
 		match_update_redraw_all(ui);
@@ -222,12 +198,7 @@ static void on_draw(SDL_Renderer *renderer, view_t *view) {
 
 	SDL_SetRenderTarget(renderer, NULL);
 	SDL_RenderCopy(renderer, canvas->data.canvas.texture, NULL, &view->rect);
-	player_t *player;
-	DL_FOREACH(GAME->players, player) {
-		if (player->texture == NULL)
-			continue;
-		SDL_RenderCopy(renderer, player->texture, NULL, &view->rect);
-	}
+	SDL_RenderCopy(renderer, trail_layer, NULL, &view->rect);
 }
 
 static void on_error(ui_t *ui) {
@@ -245,6 +216,12 @@ static void on_quit(ui_t *ui) {
 static bool on_event(ui_t *ui, fragment_t *fragment, SDL_Event *e) {
 	pkt_t *pkt = NULL;
 	switch (e->type) {
+		case SDL_RENDER_TARGETS_RESET:
+			// contents of all target textures were lost
+			match_gfx_board_invalidate();
+			first_draw = true;
+			return false;
+
 		case SDL_KEYDOWN:
 			return match_input_process_key_event(ui, e->key.keysym.scancode, true, match_update_player_state, on_quit);
 		case SDL_KEYUP:
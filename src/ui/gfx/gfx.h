@@ -36,6 +36,21 @@
 
 typedef struct font_t font_t;
 
+typedef struct gfx_mesh_line_t {
+	int x1, y1;		 //!< Start point
+	int x2, y2;		 //!< End point
+	int width;		 //!< Line thickness in pixels
+	SDL_Color color; //!< Line color
+} gfx_mesh_line_t;
+
+typedef struct gfx_mesh_t {
+	gfx_mesh_line_t *lines; //!< Lines to render
+	int lines_num;			//!< Number of lines
+	int lines_size;			//!< Allocated number of lines
+	SDL_Vertex *vertices;	//!< Triangles built from the lines (3 vertices each)
+	int vertices_size;		//!< Allocated number of vertices
+} gfx_mesh_t;
+
 // gfx.c
 void gfx_set_color(SDL_Renderer *renderer, unsigned int color);
 void gfx_draw_rect_points(SDL_Renderer *renderer, SDL_Rect *rects, int count, int width);
@@ -52,6 +67,12 @@ int gfx_get_text_width(const char *s, bool first_line);
 int gfx_get_text_height(const char *s);
 int gfx_draw_text(SDL_Renderer *renderer, int xc, int yc, const char *s);
 
+// mesh.c
+void gfx_mesh_clear(gfx_mesh_t *mesh);
+bool gfx_mesh_add_line(gfx_mesh_t *mesh, int x1, int y1, int x2, int y2, int width, SDL_Color color);
+void gfx_mesh_draw(SDL_Renderer *renderer, gfx_mesh_t *mesh);
+void gfx_mesh_free(gfx_mesh_t *mesh);
+
 // textures.c
 void texture_load(SDL_Renderer *renderer, SDL_Texture **texture, int width, int height, const uint8_t *data);
 extern SDL_Texture *texture_button_face;
@@ -0,0 +1,122 @@
+// Copyright (c) Kuba Szczodrzyński 2025-2-14.
+
+#include "gfx.h"
+
+static bool mesh_unsupported = false; //!< Whether SDL_RenderGeometry() failed before (no geometry support)
+
+/**
+ * Remove all lines from the mesh, keeping its buffers.
+ */
+void gfx_mesh_clear(gfx_mesh_t *mesh) {
+	mesh->lines_num = 0;
+}
+
+/**
+ * Add a thick line to the mesh. It's drawn like gfx_draw_line(), with square ends.
+ *
+ * @param mesh mesh to add the line to
+ * @param x1 start point X
+ * @param y1 start point Y
+ * @param x2 end point X
+ * @param y2 end point Y
+ * @param width line thickness in pixels
+ * @param color line color (alpha 0 is fully transparent)
+ * @return whether the line was added (memory allocation succeeded)
+ */
+bool gfx_mesh_add_line(gfx_mesh_t *mesh, int x1, int y1, int x2, int y2, int width, SDL_Color color) {
+	if (mesh->lines_num == mesh->lines_size) {
+		int size			   = mesh->lines_size != 0 ? mesh->lines_size * 2 : 256;
+		gfx_mesh_line_t *lines = realloc(mesh->lines, sizeof(*lines) * size);
+		if (lines == NULL)
+			LT_ERR(E, return false, "Memory allocation failed for the mesh (%d lines)", size);
+		mesh->lines		 = lines;
+		mesh->lines_size = size;
+	}
+	mesh->lines[mesh->lines_num++] = (gfx_mesh_line_t){
+		.x1	   = x1,
+		.y1	   = y1,
+		.x2	   = x2,
+		.y2	   = y2,
+		.width = width,
+		.color = color,
+	};
+	return true;
+}
+
+/**
+ * Convert the mesh's lines to triangles (two per line) and render them at once.
+ */
+static bool gfx_mesh_render_geometry(SDL_Renderer *renderer, gfx_mesh_t *mesh) {
+	int count = mesh->lines_num * 6;
+	if (count > mesh->vertices_size) {
+		SDL_Vertex *vertices = realloc(mesh->vertices, sizeof(*vertices) * count);
+		if (vertices == NULL)
+			LT_ERR(E, return false, "Memory allocation failed for the mesh (%d vertices)", count);
+		mesh->vertices		= vertices;
+		mesh->vertices_size = count;
+	}
+
+	SDL_Vertex *vertex = mesh->vertices;
+	for (int i = 0; i < mesh->lines_num; i++) {
+		gfx_mesh_line_t *line = &mesh->lines[i];
+		// use pixel centers, like the points drawn by gfx_draw_line()
+		float x1 = (float)line->x1 + 0.5f;
+		float y1 = (float)line->y1 + 0.5f;
+		float x2 = (float)line->x2 + 0.5f;
+		float y2 = (float)line->y2 + 0.5f;
+		float dx = x2 - x1;
+		float dy = y2 - y1;
+		float h	 = (float)line->width / 2.0f;
+		// unit direction vector (any direction for a single point)
+		float length = sqrtf(dx * dx + dy * dy);
+		if (length == 0.0f) {
+			dx	   = 1.0f;
+			length = 1.0f;
+		}
+		dx = dx / length * h;
+		dy = dy / length * h;
+		// extend the line by half of its width on both ends, and offset it sideways
+		SDL_FPoint corners[4] = {
+			{.x = x1 - dx - dy, .y = y1 - dy + dx},
+			{.x = x1 - dx + dy, .y = y1 - dy - dx},
+			{.x = x2 + dx + dy, .y = y2 + dy - dx},
+			{.x = x2 + dx - dy, .y = y2 + dy + dx},
+		};
+		static const int order[6] = {0, 1, 2, 0, 2, 3};
+		for (int j = 0; j < 6; j++) {
+			vertex->position  = corners[order[j]];
+			vertex->color	  = line->color;
+			vertex->tex_coord = (SDL_FPoint){0};
+			vertex++;
+		}
+	}
+
+	if (SDL_RenderGeometry(renderer, NULL, mesh->vertices, count, NULL, 0) != 0) {
+		LT_W("SDL_RenderGeometry() failed, drawing lines with rectangles: %s", SDL_GetError());
+		mesh_unsupported = true;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Render all lines of the mesh, using the current blend mode. Triangle geometry is rendered
+ * with a single call; if the renderer doesn't support it, each line is drawn using gfx_draw_line().
+ */
+void gfx_mesh_draw(SDL_Renderer *renderer, gfx_mesh_t *mesh) {
+	if (mesh->lines_num == 0)
+		return;
+	if (!mesh_unsupported && gfx_mesh_render_geometry(renderer, mesh))
+		return;
+	for (int i = 0; i < mesh->lines_num; i++) {
+		gfx_mesh_line_t *line = &mesh->lines[i];
+		SDL_SetRenderDrawColor(renderer, line->color.r, line->color.g, line->color.b, line->color.a);
+		gfx_draw_line(renderer, line->x1, line->y1, line->x2, line->y2, line->width);
+	}
+}
+
+void gfx_mesh_free(gfx_mesh_t *mesh) {
+	free(mesh->lines);
+	free(mesh->vertices);
+	memset(mesh, 0, sizeof(*mesh));
+}
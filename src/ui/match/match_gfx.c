@@ -2,106 +2,361 @@
 
 #include "match_gfx.h"
 
-static const SDL_Rect GAME_WALL_RECTS[] = {
-	{.x = 150 - 1, .y = 90 - 1,	.w = 490 - 150 + 2, .h = 5},
-	{.x = 150 - 1, .y = 190 - 1, .w = 490 - 150 + 2, .h = 5},
-	{.x = 150 - 1, .y = 288 - 1, .w = 490 - 150 + 2, .h = 5},
-	{.x = 150 - 1, .y = 388 - 1, .w = 490 - 150 + 2, .h = 5},
-};
-static const SDL_Rect GAME_TRACK_RECTS[] = {
-	{.x = 150 - 1, .y = 90 - 1 + 5,	.w = 490 - 150 + 2, .h = 100 - 5},
-	{.x = 150 - 1, .y = 288 - 1 + 5, .w = 490 - 150 + 2, .h = 100 - 5},
-};
-static const SDL_Point GAME_GATE_LINES[][2] = {
-	{{.x = 305, .y = 320}, {.x = 320, .y = 320}},
-	{{.x = 305, .y = 340}, {.x = 320, .y = 340}},
-	{{.x = 305, .y = 360}, {.x = 320, .y = 360}},
-	{{.x = 321, .y = 292}, {.x = 321, .y = 386}},
-};
+// drawn trails are split into chunks of this many segments, to find the segments crossing an area quickly
+#define MATCH_GFX_TRAIL_CHUNK  10
+#define MATCH_GFX_TRAIL_CHUNKS (PLAYER_TRAIL_NUM / MATCH_GFX_TRAIL_CHUNK)
 
-void match_gfx_board_draw(SDL_Renderer *renderer) {
+typedef struct match_gfx_trail_t {
+	unsigned int id;							//!< ID of the player whose trail is drawn
+	player_trail_t trail[PLAYER_TRAIL_NUM];		//!< Drawn trail (ring buffer, index 'head' is the latest position)
+	unsigned int head;							//!< Index of the latest drawn position
+	unsigned int steps;							//!< Value of 'trail_steps' that was drawn
+	unsigned int version;						//!< Value of 'trail_version' that was drawn
+	SDL_Rect erased;							//!< Area of the tail segments erased in the last step
+	SDL_Rect bounds[MATCH_GFX_TRAIL_CHUNKS];	//!< Area covered by the segments of every chunk of 'trail'
+} match_gfx_trail_t;
+
+// board drawn from the current track's collision grid, as horizontal spans
+static const track_t *board_track	= NULL;
+static SDL_Rect *board_rects		= NULL;
+static int board_walls_num			= 0;
+static int board_surface_num		= 0;
+static SDL_Renderer *board_renderer = NULL; //!< Renderer that the board texture was created for
+static SDL_Texture *board_texture	= NULL; //!< Board rasterized once per track and renderer
+// trails of all players, drawn on a shared layer
+static gfx_mesh_t trail_mesh			= {0};
+static match_gfx_trail_t *trails_drawn	= NULL; //!< Trails on the trail layer, in the snapshot's order
+static unsigned int trails_drawn_size	= 0;	//!< Allocated length of 'trails_drawn'
+static unsigned int trail_players		= 0;	//!< Number of players on the trail layer
+
+static int match_gfx_board_spans(const track_t *track, unsigned int flag, SDL_Rect *rects) {
+	int count = 0;
+	for (int y = 0; y < (int)track->height; y++) {
+		int start = -1;
+		for (int x = 0; x <= (int)track->width; x++) {
+			bool is_set = x < (int)track->width && (track_get_cell(track, x + 0.5, y + 0.5) & flag) != 0;
+			if (is_set && start < 0) {
+				start = x;
+			} else if (!is_set && start >= 0) {
+				if (rects != NULL)
+					rects[count] = (SDL_Rect){.x = start, .y = y, .w = x - start, .h = 1};
+				count++;
+				start = -1;
+			}
+		}
+	}
+	return count;
+}
+
+static void match_gfx_board_fill(SDL_Renderer *renderer) {
 	// draw board background
 	gfx_set_color(renderer, GFX_COLOR_BLUE);
 	SDL_RenderClear(renderer);
+	if (board_rects == NULL)
+		return;
 
 	// draw wall borders
 	gfx_set_color(renderer, GFX_COLOR_BRIGHT_WHITE);
-	SDL_RenderFillRects(renderer, GAME_WALL_RECTS, sizeof(GAME_WALL_RECTS) / sizeof(*GAME_WALL_RECTS));
-	// - outer wall arc
-	gfx_draw_half_circle(renderer, 150, 240, 90, 150, 5);
-	gfx_draw_half_circle(renderer, 489, 240, 270, 150, 5);
-	// - inner wall arc
-	gfx_draw_half_circle(renderer, 150, 240, 90, 50, 5);
-	gfx_draw_half_circle(renderer, 489, 240, 270, 50, 5);
-
+	SDL_RenderFillRects(renderer, board_rects, board_walls_num);
 	// draw track background
 	gfx_set_color(renderer, GFX_COLOR_BLACK);
-	for (int i = 150 - 5; i >= 50 + 5; i--) {
-		gfx_draw_half_circle(renderer, 150, 240, 90, i, 5);
-		gfx_draw_half_circle(renderer, 489, 240, 270, i, 5);
+	SDL_RenderFillRects(renderer, board_rects + board_walls_num, board_surface_num);
+}
+
+/**
+ * Convert the track's walls and surface to rectangles, so that the board is drawn
+ * exactly as the collisions are checked, and rasterize them into a texture.
+ *
+ * The texture is kept for as long as the track and the renderer don't change, so
+ * drawing the board in every round only copies it. If the renderer can't render
+ * to textures, the rectangles are drawn directly instead.
+ */
+static void match_gfx_board_build(SDL_Renderer *renderer, const track_t *track) {
+	free(board_rects);
+	board_rects		  = NULL;
+	board_walls_num	  = match_gfx_board_spans(track, TRACK_CELL_WALL, NULL);
+	board_surface_num = match_gfx_board_spans(track, TRACK_CELL_SURFACE, NULL);
+	MALLOC(board_rects, sizeof(*board_rects) * (board_walls_num + board_surface_num), return);
+	match_gfx_board_spans(track, TRACK_CELL_WALL, board_rects);
+	match_gfx_board_spans(track, TRACK_CELL_SURFACE, board_rects + board_walls_num);
+	board_track = track;
+
+	SDL_DestroyTexture(board_texture);
+	board_renderer = renderer;
+	board_texture  = SDL_CreateTexture(
+		 renderer,
+		 SDL_PIXELFORMAT_RGBA8888,
+		 SDL_TEXTUREACCESS_TARGET,
+		 (int)track->width,
+		 (int)track->height
+	 );
+	if (board_texture == NULL)
+		SDL_ERROR("SDL_CreateTexture()", return);
+	SDL_SetTextureBlendMode(board_texture, SDL_BLENDMODE_NONE);
+
+	SDL_Texture *target = SDL_GetRenderTarget(renderer);
+	SDL_SetRenderTarget(renderer, board_texture);
+	match_gfx_board_fill(renderer);
+	SDL_SetRenderTarget(renderer, target);
+	// the spans are not needed anymore
+	free(board_rects);
+	board_rects = NULL;
+}
+
+void match_gfx_board_draw(SDL_Renderer *renderer) {
+	if (board_track != TRACK || board_renderer != renderer)
+		match_gfx_board_build(renderer, TRACK);
+
+	if (board_texture == NULL) {
+		match_gfx_board_fill(renderer);
+		return;
 	}
-	SDL_RenderFillRects(renderer, GAME_TRACK_RECTS, sizeof(GAME_TRACK_RECTS) / sizeof(*GAME_TRACK_RECTS));
+	gfx_set_color(renderer, GFX_COLOR_BLUE);
+	SDL_RenderClear(renderer);
+	SDL_Rect rect = {.x = 0, .y = 0, .w = (int)board_track->width, .h = (int)board_track->height};
+	SDL_RenderCopy(renderer, board_texture, NULL, &rect);
+}
+
+/**
+ * Drop the rasterized board, e.g. when the render targets' contents were lost.
+ */
+void match_gfx_board_invalidate() {
+	SDL_DestroyTexture(board_texture);
+	board_texture = NULL;
+	board_track	  = NULL;
 }
 
 void match_gfx_gates_draw(SDL_Renderer *renderer, bool show) {
 	gfx_set_color(renderer, show ? GFX_COLOR_BRIGHT_MAGENTA : GFX_COLOR_BLACK);
-	for (int i = 0; i < sizeof(GAME_GATE_LINES) / sizeof(GAME_GATE_LINES[0]); i++) {
-		SDL_RenderDrawLines(renderer, GAME_GATE_LINES[i], sizeof(GAME_GATE_LINES[i]) / sizeof(*GAME_GATE_LINES[i]));
+	for (unsigned int i = 0; i < TRACK->lines_num; i++) {
+		track_gate_t *line = &TRACK->lines[i];
+		SDL_RenderDrawLine(renderer, (int)line->x1, (int)line->y1, (int)line->x2, (int)line->y2);
 	}
 }
 
-void match_gfx_player_draw(SDL_Renderer *renderer, player_t *player) {
-	if (player->state == PLAYER_IDLE)
+static void match_gfx_trail_line(player_trail_t *from, player_trail_t *to, SDL_Color color) {
+	if (from->x == to->x && from->y == to->y)
 		return;
-	// clear the renderer
+	gfx_mesh_add_line(
+		&trail_mesh,
+		(int)round(from->x),
+		(int)round(from->y),
+		(int)round(to->x),
+		(int)round(to->y),
+		3,
+		color
+	);
+}
+
+static SDL_Color match_gfx_trail_color(unsigned int color) {
+	return (SDL_Color){.r = (color >> 16) & 0xFF, .g = (color >> 8) & 0xFF, .b = color & 0xFF, .a = 0xFF};
+}
+
+/**
+ * Get the rectangle covered by a trail segment.
+ */
+static SDL_Rect match_gfx_trail_rect(player_trail_t *from, player_trail_t *to) {
+	int x1 = (int)round(from->x), y1 = (int)round(from->y);
+	int x2 = (int)round(to->x), y2 = (int)round(to->y);
+	// lines are 3 px thick, with square ends
+	return (SDL_Rect){.x = min(x1, x2) - 2, .y = min(y1, y2) - 2, .w = abs(x2 - x1) + 5, .h = abs(y2 - y1) + 5};
+}
+
+/**
+ * Get a pointer to the drawn trail position, 'index' ticks back in the trail.
+ */
+static player_trail_t *match_gfx_trail_drawn(match_gfx_trail_t *drawn, unsigned int index) {
+	return &drawn->trail[(drawn->head + index) % PLAYER_TRAIL_NUM];
+}
+
+/**
+ * Get the drawn segment starting at the slot of the drawn trail (from the newer position to the older one).
+ *
+ * @return false if no segment is drawn there (positions are the same, or the slot holds the tail)
+ */
+static bool match_gfx_trail_segment(
+	match_gfx_trail_t *drawn,
+	unsigned int slot,
+	player_trail_t **from,
+	player_trail_t **to
+) {
+	if ((slot + PLAYER_TRAIL_NUM - drawn->head) % PLAYER_TRAIL_NUM == PLAYER_TRAIL_NUM - 1)
+		return false;
+	*from = &drawn->trail[slot];
+	*to	  = &drawn->trail[(slot + 1) % PLAYER_TRAIL_NUM];
+	return (*from)->x != (*to)->x || (*from)->y != (*to)->y;
+}
+
+/**
+ * Recalculate the area covered by the segments of a chunk of the drawn trail.
+ */
+static void match_gfx_trail_bounds(match_gfx_trail_t *drawn, unsigned int chunk) {
+	SDL_Rect *bounds   = &drawn->bounds[chunk];
+	unsigned int first = chunk * MATCH_GFX_TRAIL_CHUNK;
+	*bounds			   = (SDL_Rect){0};
+	for (unsigned int slot = first; slot < first + MATCH_GFX_TRAIL_CHUNK; slot++) {
+		player_trail_t *from, *to;
+		if (!match_gfx_trail_segment(drawn, slot, &from, &to))
+			continue;
+		SDL_Rect rect = match_gfx_trail_rect(from, to);
+		if (SDL_RectEmpty(bounds))
+			*bounds = rect;
+		else
+			SDL_UnionRect(bounds, &rect, bounds);
+	}
+}
+
+/**
+ * Check whether the rectangle intersects the area erased from any trail in the last step.
+ */
+static bool match_gfx_trail_erased(SDL_Rect *rect) {
+	if (SDL_RectEmpty(rect))
+		return false;
+	for (unsigned int i = 0; i < trail_players; i++) {
+		SDL_Rect *erased = &trails_drawn[i].erased;
+		if (!SDL_RectEmpty(erased) && SDL_HasIntersection(rect, erased))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Redraw all players' trails on the trail layer (the current render target).
+ */
+static void match_gfx_trails_redraw(SDL_Renderer *renderer, match_snapshot_t *snapshot) {
+	// chunks must cover the whole trail, and fit in the dirty chunk mask
+	BUILD_BUG_ON(PLAYER_TRAIL_NUM % MATCH_GFX_TRAIL_CHUNK != 0 || MATCH_GFX_TRAIL_CHUNKS > 32);
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
 	SDL_RenderClear(renderer);
-	// render the player's line
-	double prev_x = 0.0, prev_y = 0.0;
-	gfx_set_color(renderer, player->color);
-	for (player_pos_t *pos = &player->pos[0]; pos < player->pos + PLAYER_POS_NUM; pos++) {
-		if (pos->x == prev_x && pos->y == prev_y)
-			continue;
-		if (pos != &player->pos[0]) {
-			gfx_draw_line(renderer, (int)round(prev_x), (int)round(prev_y), (int)round(pos->x), (int)round(pos->y), 3);
+	trail_players = 0;
+
+	if (snapshot->count > trails_drawn_size) {
+		match_gfx_trail_t *drawn = realloc(trails_drawn, sizeof(*drawn) * snapshot->count);
+		if (drawn == NULL)
+			LT_ERR(E, return, "Memory allocation failed for the drawn trails (%u players)", snapshot->count);
+		trails_drawn	  = drawn;
+		trails_drawn_size = snapshot->count;
+	}
+
+	gfx_mesh_clear(&trail_mesh);
+	for (unsigned int i = 0; i < snapshot->count; i++) {
+		player_snapshot_t *player = &snapshot->players[i];
+		SDL_Color color			  = match_gfx_trail_color(player->color);
+		for (int j = 1; j < PLAYER_TRAIL_NUM && player->state != PLAYER_IDLE; j++) {
+			match_gfx_trail_line(&player->trail[j - 1], &player->trail[j], color);
+		}
+
+		match_gfx_trail_t *drawn = &trails_drawn[i];
+		drawn->id				 = player->id;
+		memcpy(drawn->trail, player->trail, sizeof(drawn->trail));
+		drawn->head	   = 0;
+		drawn->steps   = player->trail_steps;
+		drawn->version = player->trail_version;
+		drawn->erased  = (SDL_Rect){0};
+		for (unsigned int chunk = 0; chunk < MATCH_GFX_TRAIL_CHUNKS; chunk++) {
+			match_gfx_trail_bounds(drawn, chunk);
 		}
-		prev_x = pos->x;
-		prev_y = pos->y;
 	}
+	gfx_mesh_draw(renderer, &trail_mesh);
+	trail_players = snapshot->count;
 }
 
-void match_gfx_player_draw_step(SDL_Renderer *renderer, player_t *player) {
-	match_gfx_player_draw(renderer, player);
-	return;
-	if (player->state == PLAYER_PLAYING) {
-		// draw the head
-		gfx_set_color(renderer, player->color);
-		gfx_draw_line(
-			renderer,
-			(int)round(player->pos[1].x),
-			(int)round(player->pos[1].y),
-			(int)round(player->pos[0].x),
-			(int)round(player->pos[0].y),
-			3
-		);
+/**
+ * Draw the players' trails on the trail layer (the current render target), shared by all players.
+ *
+ * Only the changes since the last call are drawn: tail segments that left the trails are erased,
+ * then the new head segments are drawn, together with all segments crossing the erased areas (which
+ * were partially erased along with the tails). The crossing segments are only looked for in the chunks
+ * of the trails whose areas overlap the erased ones. All segments are rendered as a single mesh.
+ *
+ * The whole layer is redrawn if 'redraw' is set, if positions that were already drawn changed
+ * (rollback, new round), if a player joined or left, or if a trail moved too far.
+ * The drawn trails are kept by the UI, matched to the snapshot's players by their IDs.
+ */
+void match_gfx_trails_draw(SDL_Renderer *renderer, match_snapshot_t *snapshot, bool redraw) {
+	if (snapshot->count != trail_players)
+		redraw = true;
+	for (unsigned int i = 0; i < snapshot->count && !redraw; i++) {
+		player_snapshot_t *player = &snapshot->players[i];
+		match_gfx_trail_t *drawn  = &trails_drawn[i];
+		if (drawn->id != player->id || drawn->version != player->trail_version ||
+			player->trail_steps - drawn->steps >= PLAYER_TRAIL_NUM - 1)
+			redraw = true;
 	}
-	if (player->state == PLAYER_IDLE)
-		return;
-	if (player->pos[0].x == player->pos[PLAYER_POS_NUM - 2].x && player->pos[0].y == player->pos[PLAYER_POS_NUM - 2].y)
+	if (redraw) {
+		match_gfx_trails_redraw(renderer, snapshot);
 		return;
-	if (player->pos[PLAYER_POS_NUM - 1].x == player->pos[PLAYER_POS_NUM - 2].x &&
-		player->pos[PLAYER_POS_NUM - 1].y == player->pos[PLAYER_POS_NUM - 2].y)
-		return;
-	// erase the tail
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	}
+
+	// erase the tails, remembering the erased area of each player
+	SDL_Color transparent = {0};
+	bool any_erased		  = false;
+	gfx_mesh_clear(&trail_mesh);
+	for (unsigned int i = 0; i < snapshot->count; i++) {
+		match_gfx_trail_t *drawn = &trails_drawn[i];
+		unsigned int steps		 = snapshot->players[i].trail_steps - drawn->steps;
+		drawn->erased			 = (SDL_Rect){0};
+		for (unsigned int j = 0; j < steps; j++) {
+			player_trail_t *tail = match_gfx_trail_drawn(drawn, PLAYER_TRAIL_NUM - 1 - j);
+			player_trail_t *next = match_gfx_trail_drawn(drawn, PLAYER_TRAIL_NUM - 2 - j);
+			if (tail->x == next->x && tail->y == next->y)
+				continue;
+			match_gfx_trail_line(tail, next, transparent);
+			SDL_Rect rect = match_gfx_trail_rect(tail, next);
+			if (SDL_RectEmpty(&drawn->erased))
+				drawn->erased = rect;
+			else
+				SDL_UnionRect(&drawn->erased, &rect, &drawn->erased);
+			any_erased = true;
+		}
+	}
 	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
-	gfx_draw_line(
-		renderer,
-		(int)round(player->pos[PLAYER_POS_NUM - 1].x),
-		(int)round(player->pos[PLAYER_POS_NUM - 1].y),
-		(int)round(player->pos[PLAYER_POS_NUM - 2].x),
-		(int)round(player->pos[PLAYER_POS_NUM - 2].y),
-		3
-	);
+	gfx_mesh_draw(renderer, &trail_mesh);
 	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+	// draw the heads, oldest first
+	gfx_mesh_clear(&trail_mesh);
+	for (unsigned int i = 0; i < snapshot->count; i++) {
+		player_snapshot_t *player = &snapshot->players[i];
+		match_gfx_trail_t *drawn  = &trails_drawn[i];
+		unsigned int steps		  = player->trail_steps - drawn->steps;
+		SDL_Color color			  = match_gfx_trail_color(player->color);
+		uint32_t dirty			  = 0;
+		for (unsigned int j = steps; j > 0; j--) {
+			match_gfx_trail_line(&player->trail[j], &player->trail[j - 1], color);
+			drawn->head				  = (drawn->head + PLAYER_TRAIL_NUM - 1) % PLAYER_TRAIL_NUM;
+			drawn->trail[drawn->head] = player->trail[j - 1];
+			// the new head changes the segments starting at its slot and at the previous one
+			unsigned int prev = (drawn->head + PLAYER_TRAIL_NUM - 1) % PLAYER_TRAIL_NUM;
+			dirty |= (1 << (drawn->head / MATCH_GFX_TRAIL_CHUNK)) | (1 << (prev / MATCH_GFX_TRAIL_CHUNK));
+		}
+		for (unsigned int chunk = 0; chunk < MATCH_GFX_TRAIL_CHUNKS; chunk++) {
+			if (dirty & (1 << chunk))
+				match_gfx_trail_bounds(drawn, chunk);
+		}
+		drawn->steps = player->trail_steps;
+	}
+
+	// repair the segments crossing the erased areas
+	for (unsigned int i = 0; i < snapshot->count && any_erased; i++) {
+		player_snapshot_t *player = &snapshot->players[i];
+		match_gfx_trail_t *drawn  = &trails_drawn[i];
+		if (player->state == PLAYER_IDLE)
+			continue;
+		SDL_Color color = match_gfx_trail_color(player->color);
+		for (unsigned int chunk = 0; chunk < MATCH_GFX_TRAIL_CHUNKS; chunk++) {
+			if (!match_gfx_trail_erased(&drawn->bounds[chunk]))
+				continue;
+			unsigned int first = chunk * MATCH_GFX_TRAIL_CHUNK;
+			for (unsigned int slot = first; slot < first + MATCH_GFX_TRAIL_CHUNK; slot++) {
+				player_trail_t *from, *to;
+				if (!match_gfx_trail_segment(drawn, slot, &from, &to))
+					continue;
+				SDL_Rect rect = match_gfx_trail_rect(from, to);
+				if (match_gfx_trail_erased(&rect))
+					match_gfx_trail_line(from, to, color);
+			}
+		}
+	}
+	gfx_mesh_draw(renderer, &trail_mesh);
 }
@@ -5,6 +5,6 @@
 #include "include.h"
 
 void match_gfx_board_draw(SDL_Renderer *renderer);
+void match_gfx_board_invalidate();
 void match_gfx_gates_draw(SDL_Renderer *renderer, bool show);
-void match_gfx_player_draw(SDL_Renderer *renderer, player_t *player);
-void match_gfx_player_draw_step(SDL_Renderer *renderer, player_t *player);
+void match_gfx_trails_draw(SDL_Renderer *renderer, match_snapshot_t *snapshot, bool redraw);
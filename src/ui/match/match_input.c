@@ -71,15 +71,17 @@ bool match_input_process_key_event(
 		// send a keypress event for a single player
 		player_pos_dir_t direction = pressed ? PLAYER_POS_LEFT : PLAYER_POS_FORWARD;
 		SDL_LOCK_MUTEX(player->mutex);
-		if (player->pos[0].direction != direction) {
+		player_pos_t *player_pos = PLAYER_POS(player, 0);
+		if (player_pos->direction != direction) {
 			// direction changed, assign to the local player
-			player->pos[0].direction = direction;
-			player->pos[0].confirmed = true;
+			player_pos->direction	  = direction;
+			player_pos->direction_set = true;
+			player_pos->confirmed	  = true;
 			// send player keypress packet to server
 			pkt_player_keypress_t pkt = {
 				.hdr.type  = PKT_PLAYER_KEYPRESS,
 				.id		   = player->id,
-				.time	   = player->pos[0].time,
+				.time	   = player_pos->time,
 				.direction = direction,
 			};
 			net_pkt_send_pipe(GAME->endpoints, (pkt_t *)&pkt);
@@ -9,6 +9,10 @@ static unsigned long long fps_last = 0;
 static int fps_delays[50]		   = {0};
 static int fps_index			   = 0;
 
+static uint64_t ui_frame_delay(ui_t *ui);
+static bool ui_process_event(ui_t *ui, fragment_t *fragment, fragment_t **prev_fragment, SDL_Event *e);
+static void ui_process_wakeup(ui_t *ui, fragment_t *fragment, fragment_t **prev_fragment);
+
 ui_t *ui_init(SDL_Window *window, SDL_Renderer *renderer) {
 	ui_t *ui;
 	MALLOC(ui, sizeof(*ui), return NULL);
@@ -43,8 +47,17 @@ free_menu:
 	return NULL;
 }
 
+/**
+ * Run the UI loop until the window is closed.
+ *
+ * A frame is drawn after an event arrives, but not more often than the display's refresh rate:
+ * all events received until the next frame is due are processed first. With vsync,
+ * presenting the frame already waits for the display.
+ */
 int ui_run(ui_t *ui) {
 	fragment_t *prev_fragment = NULL;
+	uint64_t frame_delay	  = ui_frame_delay(ui);
+	uint64_t frame_next		  = 0;
 	while (1) {
 		fragment_t *fragment = ui->fragments[ui->state];
 
@@ -96,39 +109,124 @@ int ui_run(ui_t *ui) {
 		}
 
 		SDL_RenderPresent(ui->renderer);
+		frame_next = SDL_GetPerformanceCounter() + frame_delay;
 
+		// wait for any event
 		SDL_Event e;
-		SDL_WaitEvent(&e);
-		switch (e.type) {
-			case SDL_QUIT:
-				return 0;
-
-			case SDL_KEYUP:
-				if (e.key.keysym.sym == SDLK_F1)
-					gfx_view_bounding_box = !gfx_view_bounding_box;
-				else if (e.key.keysym.sym == SDLK_F3)
-					fps_show = !fps_show;
-				else if (e.key.keysym.sym == SDLK_F5)
-					prev_fragment = NULL, fragment_reload(fragment, ui);
-				else if (e.key.keysym.sym == SDLK_F10)
-					net_client_stop(), net_server_stop(), ui_state_prev(ui);
-				else if (e.key.keysym.sym == SDLK_F12)
-					SETTINGS->net_slowdown = !SETTINGS->net_slowdown;
-				// intentional fall-through
-
-			default:
-				if (fragment == NULL)
-					break;
-				if (fragment->on_event != NULL && fragment->on_event(ui, fragment, &e) == true)
-					break;
-				if (fragment->views != NULL && gfx_view_on_event(fragment->views, &e) == true)
-					break;
+		if (SDL_WaitEvent(&e) != 1)
+			continue;
+		while (ui_process_event(ui, fragment, &prev_fragment, &e)) {
+			if (ui->fragments[ui->state] != fragment)
+				// show the new fragment first
+				break;
+			// process more events until the next frame is due
+			uint64_t now = SDL_GetPerformanceCounter();
+			int timeout	 = now < frame_next ? (int)((frame_next - now) * 1000 / SDL_GetPerformanceFrequency()) : 0;
+			if ((timeout > 0 ? SDL_WaitEventTimeout(&e, timeout) : SDL_PollEvent(&e)) != 1)
 				break;
 		}
+		if (e.type == SDL_QUIT)
+			return 0;
+	}
+}
+
+/**
+ * Get the minimum time between frames (performance counter ticks), based on the display's refresh rate.
+ * Returns 0 if the renderer presents frames with vsync.
+ */
+static uint64_t ui_frame_delay(ui_t *ui) {
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(ui->renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC))
+		return 0;
+	SDL_DisplayMode mode;
+	int refresh_rate = 60;
+	if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(ui->window), &mode) == 0 && mode.refresh_rate > 0)
+		refresh_rate = mode.refresh_rate;
+	LT_I("UI: drawing up to %d frames per second", refresh_rate);
+	return SDL_GetPerformanceFrequency() / refresh_rate;
+}
+
+/**
+ * Process a single event.
+ *
+ * @return false if the UI should quit
+ */
+static bool ui_process_event(ui_t *ui, fragment_t *fragment, fragment_t **prev_fragment, SDL_Event *e) {
+	switch (e->type) {
+		case SDL_QUIT:
+			return false;
+
+		case SDL_USEREVENT_WAKEUP:
+			ui_process_wakeup(ui, fragment, prev_fragment);
+			return true;
+
+		case SDL_USEREVENT_GAME:
+			// process the packets sent before the game stopped
+			ui_process_wakeup(ui, fragment, prev_fragment);
+			if (ui->fragments[ui->state] != fragment) {
+				// deliver it to the new fragment
+				SDL_PushEvent(e);
+				return true;
+			}
+			break;
+
+		case SDL_KEYUP:
+			if (e->key.keysym.sym == SDLK_F1)
+				gfx_view_bounding_box = !gfx_view_bounding_box;
+			else if (e->key.keysym.sym == SDLK_F3)
+				fps_show = !fps_show;
+			else if (e->key.keysym.sym == SDLK_F5)
+				*prev_fragment = NULL, fragment_reload(fragment, ui);
+			else if (e->key.keysym.sym == SDLK_F10)
+				net_client_stop(), net_server_stop(), ui_state_prev(ui);
+			else if (e->key.keysym.sym == SDLK_F12)
+				SETTINGS->net_slowdown = !SETTINGS->net_slowdown;
+			break;
+	}
 
-		// free custom packets that need it
-		if (e.type == SDL_USEREVENT_PACKET)
-			free(e.user.data1);
+	// pass the event to the fragment, then to its views
+	if (fragment != NULL) {
+		bool handled = fragment->on_event != NULL && fragment->on_event(ui, fragment, e) == true;
+		if (!handled && fragment->views != NULL)
+			gfx_view_on_event(fragment->views, e);
+	}
+
+	// free custom packets that need it
+	if (e->type == SDL_USEREVENT_PACKET)
+		free(e->user.data1);
+	return true;
+}
+
+/**
+ * Pull the state shared by the game and match threads: process the queued packets in order,
+ * then the raised match updates (once each, regardless of how many times they were raised).
+ * Stops when the fragment changes - the rest is processed after the new fragment is shown.
+ */
+static void ui_process_wakeup(ui_t *ui, fragment_t *fragment, fragment_t **prev_fragment) {
+	wakeup_ack();
+
+	pkt_t *pkt;
+	while ((pkt = net_pkt_queue_pop()) != NULL) {
+		SDL_Event e = {
+			.user.type	= SDL_USEREVENT_PACKET,
+			.user.data1 = pkt,
+		};
+		ui_process_event(ui, fragment, prev_fragment, &e);
+		if (ui->fragments[ui->state] != fragment) {
+			wakeup_ui();
+			return;
+		}
+	}
+
+	int codes = wakeup_take_match();
+	for (int code = MATCH_UPDATE_REDRAW_ALL; code <= MATCH_UPDATE_REDRAW_PLAYERS; code++) {
+		if ((codes & (1 << code)) == 0)
+			continue;
+		SDL_Event e = {
+			.user.type = SDL_USEREVENT_MATCH,
+			.user.code = code,
+		};
+		ui_process_event(ui, fragment, prev_fragment, &e);
 	}
 }
 
@@ -145,5 +243,10 @@ void ui_free(ui_t *ui) {
 			gfx_view_free(fragment->views);
 	}
 	SDL_DestroyTexture(ui->texture);
+	// drop the packets not processed anymore
+	pkt_t *pkt;
+	while ((pkt = net_pkt_queue_pop()) != NULL) {
+		free(pkt);
+	}
 	free(ui);
 }